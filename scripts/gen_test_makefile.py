@@ -91,6 +91,23 @@ def set_standard ():
     std_flags.value += common.StdID.get_full_pretty_std_name(common.selected_standard)
     adjust_sources_to_standard()
 
+###############################################################################
+# Section for test functions
+
+
+def set_func_num(func_num):
+    """The test can be split into several functions (yarpgen's --func-num option),
+    each of them in a separate file. It should be called before set_standard()."""
+    if func_num < 1:
+        common.print_and_exit("Number of test functions should be positive")
+    if func_num == 1:
+        return
+    sources.value = " ".join(["driver"] + ["func_" + str(i) for i in range(func_num)])
+
+
+def get_func_num():
+    return len([source for source in sources.value.split() if source.startswith("func")])
+
 ###############################################################################
 # Section for sde
 
@@ -377,7 +394,7 @@ def gen_makefile(out_file_name, force, config_file, only_target=None, inject_bla
         # For performance reasons driver should always be compiled with -O0
         optflags_name = "$(OPTFLAGS)" if source_name != "driver" else "$(DRIVER_OPTFLAGS)"
         output += "\t" + "$(COMPILER) $(CXXFLAGS) $(STDFLAGS) " + optflags_name + " -o $@ -c $<"
-        if source_name == "func":
+        if source_name.startswith("func"):
             output += " $(STATFLAGS) "
             if inject_blame_opt is not None:
                 output += " $(BLAMEOPTS) "
@@ -444,6 +461,8 @@ if __name__ == '__main__':
                         help="Source file to reduce")
     parser.add_argument("--collect-stat", dest="collect_stat", default="", type=str,
                         help="List of testing sets for statistics collection")
+    parser.add_argument("--func-num", dest="func_num", default=1, type=int,
+                        help="Number of test functions (should match yarpgen's --func-num option)")
     args = parser.parse_args()
 
     log_level = logging.DEBUG if args.verbose else logging.INFO
@@ -451,6 +470,7 @@ if __name__ == '__main__':
 
     common.check_python_version()
     common.set_standard(args.std_str)
+    set_func_num(args.func_num)
     set_standard()
     gen_makefile(os.path.abspath(args.out_file), args.force, args.config_file, creduce_file=args.creduce_file,
                  stat_targets=args.collect_stat.split())
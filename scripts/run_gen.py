@@ -200,6 +200,14 @@ class Test(object):
     # Static variables
     # Don't save anything other than log-file if compile time expires
     ignore_comp_time_exp = True
+    # Limit for the estimated number of executed statements (0 means no limit)
+    max_dyn_ops = 0
+    # Limit for the estimated compile cost (0 means no limit)
+    max_compile_cost = 0
+    # Time budget for the generator in milliseconds (0 means no limit)
+    gen_deadline_ms = 0
+    # Soft memory limit for the generator in kbytes (0 means no limit)
+    gen_mem_budget = 0
 
     # Generate new test
     # stat is statistics object
@@ -211,6 +219,17 @@ class Test(object):
                             "--std=" + common.StdID.get_pretty_std_name(common.selected_standard)]
         if seed:
             yarpgen_run_list += ["-s", seed]
+        func_num = gen_test_makefile.get_func_num()
+        if func_num > 1:
+            yarpgen_run_list += ["--func-num=" + str(func_num)]
+        if Test.max_dyn_ops:
+            yarpgen_run_list += ["--max-dyn-ops=" + str(Test.max_dyn_ops)]
+        if Test.max_compile_cost:
+            yarpgen_run_list += ["--max-compile-cost=" + str(Test.max_compile_cost)]
+        if Test.gen_deadline_ms:
+            yarpgen_run_list += ["--deadline-ms=" + str(Test.gen_deadline_ms)]
+        if Test.gen_mem_budget:
+            yarpgen_run_list += ["--mem-budget=" + str(Test.gen_mem_budget)]
         self.yarpgen_cmd = " ".join(str(p) for p in yarpgen_run_list)
         self.ret_code, self.stdout, self.stderr, self.is_time_expired, self.elapsed_time = \
             common.run_cmd(yarpgen_run_list, yarpgen_timeout, proc_num, yarpgen_mem_limit)
@@ -854,6 +873,10 @@ class TestRun(object):
     def build(self):
         # build
         build_params_list = ["make", "-f", gen_test_makefile.Test_Makefile_name, self.optset]
+        # Test functions are in separate files, so they can be compiled in parallel
+        func_num = gen_test_makefile.get_func_num()
+        if func_num > 1:
+            build_params_list.insert(1, "-j" + str(func_num + 1))
         self.build_cmd = " ".join(str(p) for p in build_params_list)
         self.build_ret_code, self.build_stdout, self.build_stderr, self.is_build_time_expired, self.build_elapsed_time = \
             common.run_cmd(build_params_list, compiler_timeout, self.proc_num, compiler_mem_limit)
@@ -1757,6 +1780,24 @@ Use specified folder for testing
                         help="List of testing sets for statistics collection")
     parser.add_argument("--ignore-comp-time-exp", dest="ignore_comp_time_exp", default=True, action="store_true",
                         help="Don't save files (except log-file) when compile time expires")
+    parser.add_argument("--func-num", dest="func_num", default=1, type=int,
+                        help="Split each test into this number of functions in separate files, "
+                             "so the files can be compiled in parallel")
+    parser.add_argument("--max-dyn-ops", dest="max_dyn_ops", default=0, type=int,
+                        help="Limit for the estimated number of statements that each test executes, "
+                             "so the tests don't hit the run timeout (0 means no limit)")
+    parser.add_argument("--max-compile-cost", dest="max_compile_cost", default=0, type=int,
+                        help="Limit for the estimated compile cost of each test, "
+                             "so the tests don't hit the compiler timeout (0 means no limit)")
+    parser.add_argument("--gen-deadline-ms", dest="gen_deadline_ms", default=0, type=int,
+                        help="Time budget for the generator in milliseconds. The generator cuts the test short, "
+                             "so it doesn't hit the generator timeout. The test depends on the load of the machine "
+                             "and can't be regenerated from the seed, so it is off by default (0 means no limit)")
+    parser.add_argument("--gen-mem-budget", dest="gen_mem_budget", default=0, type=int,
+                        help="Soft limit for the generator's IR objects in kbytes. The generator makes the test "
+                             "smaller as it approaches the limit. It counts only the objects themselves, "
+                             "which are several times smaller than RSS, so it isn't comparable to "
+                             "the generator memory limit (0 means no limit)")
     args = parser.parse_args()
 
     log_level = logging.DEBUG if args.verbose else logging.INFO
@@ -1777,9 +1818,14 @@ Use specified folder for testing
         creduce_n = args.creduce
 
     common.set_standard(args.std_str)
+    gen_test_makefile.set_func_num(args.func_num)
     gen_test_makefile.set_standard()
 
     Test.ignore_comp_time_exp = args.ignore_comp_time_exp
+    Test.max_dyn_ops = args.max_dyn_ops
+    Test.max_compile_cost = args.max_compile_cost
+    Test.gen_deadline_ms = args.gen_deadline_ms
+    Test.gen_mem_budget = args.gen_mem_budget
     prepare_env_and_start_testing(os.path.abspath(args.out_dir), args.timeout, args.target, args.num_jobs,
                                   args.config_file, args.seeds_option_value, args.blame, args.creduce,
                                   args.no_tmp_cleaner, args.collect_stat)
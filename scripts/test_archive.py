@@ -0,0 +1,159 @@
+#!/usr/bin/python3
+###############################################################################
+#
+# Copyright (c) 2020, Intel Corporation
+# Copyright (c) 2020, University of Utah
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+###############################################################################
+"""
+Script for reading of test archives, created with yarpgen's --archive option.
+See src/archive.h for the description of the format.
+"""
+###############################################################################
+
+import argparse
+import collections
+import os
+import sys
+
+index_ext = ".idx"
+record_magic = b"YARPGEN_TEST"
+
+IndexEntry = collections.namedtuple("IndexEntry", ["seed", "options_hash", "content_hash", "offset", "length"])
+
+
+def fnv1a(data):
+    fnv_hash = 0xcbf29ce484222325
+    for byte in data:
+        fnv_hash ^= byte
+        fnv_hash = (fnv_hash * 0x100000001b3) & 0xffffffffffffffff
+    return fnv_hash
+
+
+def read_index(archive_name):
+    """Yields entries of the archive index in the order they were added"""
+    with open(archive_name + index_ext, "r") as index_file:
+        for line in index_file:
+            fields = line.split()
+            if len(fields) != 5:
+                continue
+            yield IndexEntry(int(fields[0]), fields[1], fields[2], int(fields[3]), int(fields[4]))
+
+
+def find_entry(archive_name, seed, options_hash=None):
+    """Returns the last index entry for the seed (and options hash) or None"""
+    result = None
+    for entry in read_index(archive_name):
+        if entry.seed == seed and (options_hash is None or entry.options_hash == options_hash):
+            result = entry
+    return result
+
+
+def read_test(archive_name, entry, check_hash=True):
+    """Returns an ordered dictionary with file names and contents (bytes) of the test"""
+    with open(archive_name, "rb") as archive_file:
+        archive_file.seek(entry.offset)
+        record = archive_file.read(entry.length)
+    if len(record) != entry.length:
+        raise ValueError("Archive record is truncated")
+
+    header, _, body = record.partition(b"\n")
+    magic, files_num, content_hash = header.split()
+    if magic != record_magic or content_hash.decode() != entry.content_hash:
+        raise ValueError("Index entry doesn't match the archive record")
+
+    files = collections.OrderedDict()
+    # Content hash doesn't cover the headers of the files
+    hashed_content = bytearray()
+    pos = 0
+    for i in range(int(files_num)):
+        line_end = body.index(b"\n", pos)
+        name, size, header_size = body[pos:line_end].decode().rsplit(" ", 2)
+        pos = line_end + 1
+        contents = body[pos:pos + int(size)]
+        files[name] = contents
+        pos += int(size)
+        hashed_content += (name + " " + str(int(size) - int(header_size)) + "\n").encode()
+        hashed_content += contents[int(header_size):]
+    if check_hash and "{:016x}".format(fnv1a(hashed_content)) != entry.content_hash:
+        raise ValueError("Content hash mismatch")
+    return files
+
+
+def extract_test(archive_name, entry, out_dir):
+    """Writes files of the test to the directory (it should exist)"""
+    files = read_test(archive_name, entry)
+    for name, contents in files.items():
+        with open(os.path.join(out_dir, name), "wb") as out_file:
+            out_file.write(contents)
+    return list(files.keys())
+
+###############################################################################
+
+
+def get_entry_or_exit(args):
+    entry = find_entry(args.archive, args.seed, args.options_hash)
+    if entry is None:
+        sys.stderr.write("Can't find seed " + str(args.seed) + " in " + args.archive + "\n")
+        sys.exit(-1)
+    return entry
+
+
+def list_cmd(args):
+    for entry in read_index(args.archive):
+        print(entry.seed, entry.options_hash, entry.content_hash, entry.offset, entry.length)
+
+
+def extract_cmd(args):
+    os.makedirs(args.out_dir, exist_ok=True)
+    for name in extract_test(args.archive, get_entry_or_exit(args), args.out_dir):
+        print(os.path.join(args.out_dir, name))
+
+
+def cat_cmd(args):
+    files = read_test(args.archive, get_entry_or_exit(args))
+    if args.file not in files:
+        sys.stderr.write("Test doesn't have file " + args.file + "\n")
+        sys.exit(-1)
+    sys.stdout.buffer.write(files[args.file])
+
+
+if __name__ == '__main__':
+    description = "Lists and extracts tests from yarpgen's test archives"
+    parser = argparse.ArgumentParser(description=description, formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    subparsers = parser.add_subparsers(dest="command")
+    subparsers.required = True
+
+    list_parser = subparsers.add_parser("list", help="Print the index of the archive")
+    list_parser.set_defaults(action=list_cmd)
+
+    extract_parser = subparsers.add_parser("extract", help="Write files of the test to the directory")
+    extract_parser.add_argument("-o", "--out-dir", dest="out_dir", default=".", type=str,
+                                help="Output directory")
+    extract_parser.set_defaults(action=extract_cmd)
+
+    cat_parser = subparsers.add_parser("cat", help="Write one file of the test to stdout")
+    cat_parser.set_defaults(action=cat_cmd)
+
+    for sub_parser in [list_parser, extract_parser, cat_parser]:
+        sub_parser.add_argument("archive", type=str, help="Archive file")
+    cat_parser.add_argument("file", type=str, help="Name of the file, e.g. func.cpp")
+    for sub_parser in [extract_parser, cat_parser]:
+        sub_parser.add_argument("-s", "--seed", dest="seed", required=True, type=int, help="Seed of the test")
+        sub_parser.add_argument("--options-hash", dest="options_hash", default=None, type=str,
+                                help="Options hash of the test (the last test with the seed is used by default)")
+
+    args = parser.parse_args()
+    args.action(args)
@@ -0,0 +1,193 @@
+#!/usr/bin/python3
+###############################################################################
+#
+# Copyright (c) 2020, Intel Corporation
+# Copyright (c) 2020, University of Utah
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+###############################################################################
+"""
+End-to-end throughput benchmark for yarpgen.
+It generates a fixed corpus of seeds for every language standard at several
+scales and appends the results to a CSV file, so a new build can be compared
+with the history.
+
+A scale is a pair of --stmt-num-lim and --max-arith-depth options of yarpgen.
+The number of statements is decided by the random structure of the test, and
+--stmt-num-lim is only a cap on it. The tests rarely have more than ~1000
+statements, so bigger caps don't change them. The depth of the expressions
+is what grows the test, so the default scales differ only in it. The average
+size of the generated test is reported, so it can be checked that the scales
+really differ.
+"""
+###############################################################################
+
+import argparse
+import csv
+import datetime
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+import common
+
+csv_fields = ["date", "version", "std", "stmt_num_cap", "max_arith_depth", "seeds",
+              "kb_per_seed", "seeds_per_sec", "mb_per_sec", "p50_ms", "p99_ms", "peak_rss_mb"]
+
+
+def exit_with_error(msg):
+    sys.stderr.write(msg + "\n")
+    sys.exit(-1)
+
+
+def get_version(yarpgen_bin):
+    output = subprocess.check_output([yarpgen_bin, "-v"], universal_newlines=True)
+    return output.strip().replace("yarpgen version ", "")
+
+
+def parse_scales(scales):
+    """Parses "stmt_num_cap:max_arith_depth,..." into a list of pairs"""
+    result = []
+    for scale in scales.split(","):
+        stmt_num_cap, max_arith_depth = scale.split(":")
+        result.append((int(stmt_num_cap), int(max_arith_depth)))
+    return result
+
+
+def percentile(values, pct):
+    """Nearest-rank percentile of the sorted list"""
+    rank = max(1, -(-len(values) * pct // 100))
+    return values[int(rank) - 1]
+
+
+def dir_size(path):
+    return sum(os.path.getsize(os.path.join(path, name)) for name in os.listdir(path))
+
+
+def run_seed(yarpgen_bin, std, scale, seed, out_dir):
+    """Returns latency (in seconds), emitted bytes and max RSS (in kbytes) of one yarpgen run"""
+    cmd = [yarpgen_bin, "--std=" + std, "--seed=" + str(seed), "--out-dir=" + out_dir,
+           "--stmt-num-lim=" + str(scale[0]), "--max-arith-depth=" + str(scale[1])]
+    # stderr goes to a file, so the child can't block on a full pipe while we wait for it
+    with tempfile.TemporaryFile() as err_file:
+        start = time.perf_counter()
+        proc = subprocess.Popen(cmd, stdout=subprocess.DEVNULL, stderr=err_file)
+        # os.wait4 gives us the resource usage of this child only
+        _, status, rusage = os.wait4(proc.pid, 0)
+        latency = time.perf_counter() - start
+        # The child is already reaped, so Popen shouldn't try to wait for it
+        proc.returncode = status
+        if status != 0:
+            err_file.seek(0)
+            exit_with_error("yarpgen failed (" + " ".join(cmd) + "):\n" + err_file.read().decode())
+    return latency, dir_size(out_dir), rusage.ru_maxrss
+
+
+def run_config(yarpgen_bin, std, scale, seeds, out_dir):
+    latencies = []
+    total_bytes = 0
+    peak_rss = 0
+    for seed in seeds:
+        seed_dir = os.path.join(out_dir, str(seed))
+        os.makedirs(seed_dir, exist_ok=True)
+        latency, size, rss = run_seed(yarpgen_bin, std, scale, seed, seed_dir)
+        shutil.rmtree(seed_dir)
+        latencies.append(latency)
+        total_bytes += size
+        peak_rss = max(peak_rss, rss)
+
+    total_time = sum(latencies)
+    latencies.sort()
+    return {"std": std,
+            "stmt_num_cap": scale[0],
+            "max_arith_depth": scale[1],
+            "seeds": len(seeds),
+            "kb_per_seed": "{:.1f}".format(total_bytes / len(seeds) / 1024),
+            "seeds_per_sec": "{:.2f}".format(len(seeds) / total_time),
+            "mb_per_sec": "{:.2f}".format(total_bytes / total_time / 2 ** 20),
+            "p50_ms": "{:.1f}".format(percentile(latencies, 50) * 1000),
+            "p99_ms": "{:.1f}".format(percentile(latencies, 99) * 1000),
+            "peak_rss_mb": "{:.1f}".format(peak_rss / 1024)}
+
+
+def append_csv(csv_name, rows):
+    new_file = not os.path.exists(csv_name) or os.path.getsize(csv_name) == 0
+    with open(csv_name, "a", newline="") as csv_file:
+        writer = csv.DictWriter(csv_file, fieldnames=csv_fields)
+        if new_file:
+            writer.writeheader()
+        for row in rows:
+            writer.writerow(row)
+
+
+def print_table(rows):
+    print(("{:<6} {:>12} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>12}").format(
+          "std", "cap:depth", "KB/seed", "seeds/s", "MB/s", "p50 ms", "p99 ms", "rss MB", "seeds"))
+    for row in rows:
+        print(("{:<6} {:>12} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>12}").format(
+              row["std"], str(row["stmt_num_cap"]) + ":" + str(row["max_arith_depth"]),
+              row["kb_per_seed"], row["seeds_per_sec"], row["mb_per_sec"], row["p50_ms"],
+              row["p99_ms"], row["peak_rss_mb"], row["seeds"]))
+
+
+if __name__ == '__main__':
+    common.check_python_version()
+
+    description = "Measures end-to-end throughput of yarpgen and appends the results to a CSV file"
+    parser = argparse.ArgumentParser(description=description, formatter_class=argparse.ArgumentDefaultsHelpFormatter)
+    parser.add_argument("--yarpgen", dest="yarpgen_bin", default=os.path.join(common.yarpgen_scripts, "yarpgen"),
+                        type=str, help="yarpgen binary to measure")
+    parser.add_argument("--std", dest="std", default="c,c++,ispc,sycl", type=str,
+                        help="Comma-separated list of language standards")
+    parser.add_argument("--scales", dest="scales", default="1000:2,1000:5,1000:8", type=str,
+                        help="Comma-separated list of stmt_num_cap:max_arith_depth pairs "
+                             "(the first one is only a cap, tests rarely have more than ~1000 statements)")
+    parser.add_argument("-n", "--seeds", dest="seeds_num", default=50, type=int,
+                        help="Number of seeds in the corpus")
+    parser.add_argument("--first-seed", dest="first_seed", default=1, type=int,
+                        help="The first seed of the corpus (seeds are consecutive)")
+    parser.add_argument("--csv", dest="csv_name", default="throughput.csv", type=str,
+                        help="CSV file with the history of results")
+    parser.add_argument("--out-dir", dest="out_dir", default=None, type=str,
+                        help="Directory for generated tests (temporary directory by default)")
+    args = parser.parse_args()
+
+    if not os.path.isfile(args.yarpgen_bin):
+        exit_with_error("Can't find yarpgen binary " + args.yarpgen_bin)
+    if args.seeds_num <= 0:
+        exit_with_error("Number of seeds should be positive")
+
+    version = get_version(args.yarpgen_bin)
+    date = datetime.datetime.now().strftime("%Y-%m-%d %H:%M:%S")
+    seeds = range(args.first_seed, args.first_seed + args.seeds_num)
+    out_dir = args.out_dir if args.out_dir else tempfile.mkdtemp(prefix="yarpgen_bench_")
+
+    rows = []
+    try:
+        for std in args.std.split(","):
+            for scale in parse_scales(args.scales):
+                row = run_config(args.yarpgen_bin, std, scale, seeds, out_dir)
+                row["date"] = date
+                row["version"] = version
+                rows.append(row)
+    finally:
+        if not args.out_dir:
+            shutil.rmtree(out_dir, ignore_errors=True)
+
+    print("yarpgen " + version)
+    print_table(rows)
+    append_csv(args.csv_name, rows)
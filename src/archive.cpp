@@ -0,0 +1,119 @@
+/*
+Copyright (c) 2020, Intel Corporation
+Copyright (c) 2020, University of Utah
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+     http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//////////////////////////////////////////////////////////////////////////////
+
+#include "archive.h"
+#include "hash.h"
+#include "utils.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/file.h>
+#define YARPGEN_USE_FLOCK
+#endif
+
+using namespace yarpgen;
+
+static std::string toHex(uint64_t value) {
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016" PRIx64, value);
+    return buf;
+}
+
+// Looks for the record with the same content in the index. Returns the
+// location of the record (offset and length) or false if there is no such
+// record.
+static bool findRecord(FILE *index_file, const std::string &content_hash,
+                       std::pair<uint64_t, uint64_t> &location) {
+    rewind(index_file);
+    char line[256];
+    while (fgets(line, sizeof(line), index_file)) {
+        char hash[17];
+        unsigned long long seed = 0, offset = 0, length = 0;
+        if (sscanf(line, "%llu %*16s %16s %llu %llu", &seed, hash, &offset,
+                   &length) != 4)
+            continue;
+        if (content_hash == hash) {
+            location = std::make_pair(offset, length);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TestArchive::append(size_t seed, uint64_t options_hash,
+                         const std::vector<OutputFile> &files) {
+    // Prepare the whole record, so it can be written with a single call.
+    // Headers differ between the runs, so they are not a part of the hash.
+    size_t body_size = 0;
+    for (const auto &file : files)
+        body_size += file.name.size() + file.contents.size() + 64;
+    SourceWriter body(body_size);
+    uint64_t hash = Hash::FNV_OFFSET_BASIS;
+    for (const auto &file : files) {
+        const std::string &contents = file.contents.str();
+        size_t size = contents.size() - file.header_size;
+        SourceWriter key(file.name.size() + 32);
+        key << file.name << ' ' << size << '\n';
+        hash = Hash::hashBytes(key.str().data(), key.size(), hash);
+        hash =
+            Hash::hashBytes(contents.data() + file.header_size, size, hash);
+        body << file.name << ' ' << contents.size() << ' ' << file.header_size
+             << '\n'
+             << file.contents;
+    }
+    std::string content_hash = toHex(hash);
+    SourceWriter record(body.size() + 64);
+    record << "YARPGEN_TEST " << files.size() << ' ' << content_hash << '\n'
+           << body;
+
+    std::string index_name = file_name + ".idx";
+    FILE *index_file = fopen(index_name.c_str(), "a+");
+    if (!index_file)
+        ERROR("Can't open archive index " + index_name);
+#ifdef YARPGEN_USE_FLOCK
+    if (flock(fileno(index_file), LOCK_EX) != 0)
+        ERROR("Can't lock archive index " + index_name);
+#endif
+
+    std::pair<uint64_t, uint64_t> location;
+    if (!findRecord(index_file, content_hash, location)) {
+        FILE *data_file = fopen(file_name.c_str(), "ab");
+        if (!data_file)
+            ERROR("Can't open archive " + file_name);
+        fseek(data_file, 0, SEEK_END);
+        long offset = ftell(data_file);
+        if (offset < 0 ||
+            fwrite(record.str().data(), 1, record.size(), data_file) !=
+                record.size() ||
+            fclose(data_file) != 0)
+            ERROR("Can't write to archive " + file_name);
+        location = std::make_pair(offset, record.size());
+    }
+
+    fprintf(index_file, "%zu %s %s %" PRIu64 " %" PRIu64 "\n", seed,
+            toHex(options_hash).c_str(), content_hash.c_str(), location.first,
+            location.second);
+    if (fflush(index_file) != 0)
+        ERROR("Can't write to archive index " + index_name);
+
+#ifdef YARPGEN_USE_FLOCK
+    flock(fileno(index_file), LOCK_UN);
+#endif
+    fclose(index_file);
+}
@@ -0,0 +1,75 @@
+/*
+Copyright (c) 2020, Intel Corporation
+Copyright (c) 2020, University of Utah
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+     http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "source_writer.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace yarpgen {
+
+// Generated file. It can start with a header comment that describes the
+// run of the generator (seed, invocation, etc.).
+struct OutputFile {
+    OutputFile(std::string _name, SourceWriter _contents)
+        : name(std::move(_name)), contents(std::move(_contents)),
+          header_size(0) {}
+
+    std::string name;
+    SourceWriter contents;
+    size_t header_size;
+};
+
+// Append-only storage for generated tests. Big testing campaigns produce
+// millions of small files, so instead we can append every test to a single
+// data file and keep a text index next to it.
+//
+// Each record in the data file looks like this:
+//     YARPGEN_TEST <number of files> <content hash>\n
+//     <file name> <size> <header size>\n<contents of the file>
+// The second line is repeated for every file. The header is the comment at
+// the beginning of the file that describes the run of the generator.
+// The index file (<archive>.idx) has a line for every generated test:
+//     <seed> <options hash> <content hash> <offset> <length>\n
+// Offset and length describe the whole record in the data file. Hashes are
+// 64-bit FNV-1a values written as 16 hex digits. The content hash covers
+// the names of the files and their contents without the headers, i.e.
+//     <file name> <size without the header>\n<contents without the header>
+// for every file. The same program can be generated with different seeds
+// and command lines. If the archive already has a record with the same
+// content, we add only a new index line, and the headers in the stored
+// record are from the run that added it.
+//
+// Several generators can append to the same archive at the same time. The
+// index file is locked while we update the archive (POSIX systems only).
+// scripts/test_archive.py can list and extract the tests.
+class TestArchive {
+  public:
+    explicit TestArchive(std::string _file_name)
+        : file_name(std::move(_file_name)) {}
+
+    void append(size_t seed, uint64_t options_hash,
+                const std::vector<OutputFile> &files);
+
+  private:
+    std::string file_name;
+};
+
+} // namespace yarpgen
@@ -0,0 +1,422 @@
+/*
+Copyright (c) 2020, Intel Corporation
+Copyright (c) 2020, University of Utah
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+     http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Microbenchmarks for the hot paths of the generator. Every benchmark starts
+// with the same seed and runs a fixed number of iterations, so the results
+// are comparable between the builds. The optional argument selects the
+// benchmarks with the name that contains it.
+//
+// On Linux we also measure the phases of the generation with hardware
+// performance counters, so we can see if the phases are memory-bound.
+
+#include "context.h"
+#include "expr.h"
+#include "ir_value.h"
+#include "statistics.h"
+#include "stmt.h"
+#include "type.h"
+#include "utils.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define YARPGEN_USE_PERF_EVENTS
+#endif
+
+using namespace yarpgen;
+
+// Every allocation of the process goes through the replaced operator new
+static std::atomic<uint64_t> alloc_num(0);
+
+void *operator new(size_t size) {
+    alloc_num++;
+    if (void *ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+// Results are accumulated here, so the compiler can't throw the work away
+static volatile uint64_t sink;
+
+static const size_t BENCH_SEED = 1234;
+
+static std::string filter;
+
+template <typename Func>
+static void runBench(const std::string &name, size_t iters, Func func) {
+    if (name.find(filter) == std::string::npos)
+        return;
+
+    rand_val_gen->setSeed(BENCH_SEED);
+    uint64_t allocs_before = alloc_num;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iters; ++i)
+        func(i);
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start);
+    uint64_t allocs = alloc_num - allocs_before;
+
+    std::cout << std::left << std::setw(36) << name << std::right
+              << std::setw(10) << iters << std::fixed << std::setprecision(1)
+              << std::setw(14)
+              << static_cast<double>(duration.count()) / iters << " ns/op"
+              << std::setprecision(2) << std::setw(10)
+              << static_cast<double>(allocs) / iters << " allocs/op"
+              << std::endl;
+}
+
+static std::string getTypeName(IntTypeID id) {
+    auto type = IntegralType::init(id);
+    return type->getName(std::make_shared<EmitCtx>());
+}
+
+static void benchIRValue() {
+    // Arithmetic is defined only for the types after integral promotion
+    const IntTypeID arith_types[] = {IntTypeID::INT, IntTypeID::UINT,
+                                     IntTypeID::LLONG, IntTypeID::ULLONG};
+    for (auto id : arith_types) {
+        IRValue lhs(id);
+        lhs.setValue({false, 12345});
+        IRValue rhs(id);
+        rhs.setValue({false, 67});
+        runBench("IRValue arith " + getTypeName(id), 2000000,
+                 [&lhs, &rhs](size_t i) {
+                     IRValue res = lhs + rhs;
+                     res = res * rhs;
+                     res = res / rhs;
+                     res = res ^ lhs;
+                     sink = sink + res.getAbsValue().value + i;
+                 });
+    }
+
+    for (auto from = static_cast<size_t>(IntTypeID::BOOL);
+         from < static_cast<size_t>(IntTypeID::MAX_INT_TYPE_ID); ++from) {
+        auto from_id = static_cast<IntTypeID>(from);
+        IRValue val(from_id);
+        val.setValue({false, 1});
+        runBench("IRValue cast " + getTypeName(from_id), 1000000,
+                 [&val](size_t i) {
+                     for (auto to = static_cast<size_t>(IntTypeID::BOOL);
+                          to < static_cast<size_t>(IntTypeID::MAX_INT_TYPE_ID);
+                          ++to) {
+                         IRValue res =
+                             val.castToType(static_cast<IntTypeID>(to));
+                         sink = sink + res.getAbsValue().value;
+                     }
+                 });
+    }
+}
+
+static void benchRandId() {
+    auto gen_pol = std::make_shared<GenPolicy>();
+    runBench("getRandId int_type_distr", 1000000, [&gen_pol](size_t) {
+        sink = sink + static_cast<size_t>(
+                          rand_val_gen->getRandId(gen_pol->int_type_distr));
+    });
+    runBench("getRandId arith_node_distr", 1000000, [&gen_pol](size_t) {
+        sink = sink + static_cast<size_t>(
+                          rand_val_gen->getRandId(gen_pol->arith_node_distr));
+    });
+    runBench("getRandId binary_op_distr", 1000000, [&gen_pol](size_t) {
+        sink = sink + static_cast<size_t>(
+                          rand_val_gen->getRandId(gen_pol->binary_op_distr));
+    });
+}
+
+// Context with input variables, like the one that ProgramGenerator creates
+static std::shared_ptr<PopulateCtx> createPopulateCtx() {
+    auto ctx = std::make_shared<PopulateCtx>();
+    auto inp_sym_tbl = std::make_shared<SymbolTable>();
+    for (size_t i = 0; i < 16; ++i) {
+        auto new_var = ScalarVar::create(ctx);
+        inp_sym_tbl->addVar(new_var);
+        inp_sym_tbl->addVarExpr(std::make_shared<ScalarVarUseExpr>(new_var));
+    }
+    ctx->setExtInpSymTable(inp_sym_tbl);
+    ctx->setExtOutSymTable(std::make_shared<SymbolTable>());
+    return ctx;
+}
+
+static void benchArithExpr() {
+    rand_val_gen->setSeed(BENCH_SEED);
+    auto ctx = createPopulateCtx();
+    for (size_t depth = 1; depth <= 5; depth += 2) {
+        auto gen_pol = std::make_shared<GenPolicy>(*ctx->getGenPolicy());
+        gen_pol->max_arith_depth = depth;
+        ctx->setGenPolicy(gen_pol);
+        runBench("ArithmeticExpr::create depth " + std::to_string(depth),
+                 20000, [&ctx](size_t) {
+                     auto expr = ArithmeticExpr::create(ctx);
+                     sink = sink + expr->getComplexity();
+                 });
+    }
+}
+
+static void benchSymbolTable() {
+    rand_val_gen->setSeed(BENCH_SEED);
+    auto ctx = createPopulateCtx();
+    auto sym_tbl = ctx->getExtInpSymTable();
+    for (size_t dim_num = 1; dim_num <= 3; ++dim_num) {
+        ctx->addDimension(20);
+        for (size_t i = 0; i < 16; ++i)
+            sym_tbl->addArray(Array::create(ctx, true));
+    }
+
+    runBench("SymbolTable::getVars", 1000000, [&sym_tbl](size_t) {
+        sink = sink + sym_tbl->getVars().size();
+    });
+    runBench("SymbolTable::getArraysWithDimNum", 1000000,
+             [&sym_tbl](size_t i) {
+                 sink = sink + sym_tbl->getArraysWithDimNum(1 + i % 3).size();
+             });
+}
+
+static void benchTypeInit() {
+    runBench("IntegralType::init", 2000000, [](size_t i) {
+        auto id = static_cast<IntTypeID>(
+            i % static_cast<size_t>(IntTypeID::MAX_INT_TYPE_ID));
+        auto type = IntegralType::init(id, i % 2, CVQualifier::NONE, i % 3);
+        sink = sink + type->getBitSize();
+    });
+
+    auto base_type = IntegralType::init(IntTypeID::INT);
+    std::vector<std::vector<size_t>> dims = {{10}, {20, 20}, {10, 15, 25}};
+    runBench("ArrayType::init", 1000000, [&base_type, &dims](size_t i) {
+        auto type = ArrayType::init(base_type, dims.at(i % dims.size()));
+        sink = sink + type->getUID();
+    });
+}
+
+static void benchEmit() {
+    // The same structure as ProgramGenerator has, but without the driver
+    rand_val_gen->setSeed(BENCH_SEED);
+    auto scope = ScopeStmt::generateStructure(std::make_shared<GenCtx>());
+    scope->populate(createPopulateCtx());
+
+    SourceWriter stream;
+    runBench("ScopeStmt::emit", 50, [&scope, &stream](size_t) {
+        stream.clear();
+        scope->emit(std::make_shared<EmitCtx>(), stream);
+        sink = sink + stream.size();
+    });
+}
+
+// Group of hardware counters for the current thread. All of the counters are
+// scheduled together, so their ratios are meaningful even with multiplexing.
+class PerfCounters {
+  public:
+    static const size_t EVENTS_NUM = 4;
+    using Values = std::array<uint64_t, EVENTS_NUM>;
+
+    PerfCounters() {
+        fds.fill(-1);
+#ifdef YARPGEN_USE_PERF_EVENTS
+        const uint64_t configs[EVENTS_NUM] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        for (size_t i = 0; i < EVENTS_NUM; ++i) {
+            perf_event_attr attr = {};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = i == 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP |
+                               PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds.at(i) = static_cast<int>(
+                syscall(SYS_perf_event_open, &attr, 0, -1, fds.at(0), 0));
+            if (fds.at(i) < 0) {
+                close();
+                return;
+            }
+        }
+        ioctl(fds.at(0), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(fds.at(0), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+    ~PerfCounters() { close(); }
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool isAvailable() const { return fds.at(0) >= 0; }
+
+    // Returns the current values, scaled if the group was multiplexed
+    Values read() const {
+        Values values = {};
+#ifdef YARPGEN_USE_PERF_EVENTS
+        // nr, time_enabled, time_running, values
+        uint64_t buf[3 + EVENTS_NUM] = {};
+        if (!isAvailable() ||
+            ::read(fds.at(0), buf, sizeof(buf)) !=
+                static_cast<ssize_t>(sizeof(buf)) ||
+            buf[2] == 0)
+            return values;
+        double scale = static_cast<double>(buf[1]) / buf[2];
+        for (size_t i = 0; i < EVENTS_NUM; ++i)
+            values.at(i) = static_cast<uint64_t>(buf[3 + i] * scale);
+#endif
+        return values;
+    }
+
+  private:
+    void close() {
+#ifdef YARPGEN_USE_PERF_EVENTS
+        for (auto &fd : fds) {
+            if (fd >= 0)
+                ::close(fd);
+            fd = -1;
+        }
+#endif
+    }
+
+    std::array<int, EVENTS_NUM> fds;
+};
+
+// Counters of a single phase, accumulated over all of the seeds
+struct PhaseCounters {
+    PhaseCounters() : values(), nodes(0) {}
+
+    PerfCounters::Values values;
+    uint64_t nodes;
+};
+
+// Runs the function and adds the change of the counters to the phase
+template <typename Func>
+static void measurePhase(const PerfCounters &counters, PhaseCounters &phase,
+                         Func func) {
+    auto before = counters.read();
+    func();
+    auto after = counters.read();
+    for (size_t i = 0; i < PerfCounters::EVENTS_NUM; ++i)
+        phase.values.at(i) += after.at(i) - before.at(i);
+}
+
+static void printPhaseCounters(const std::string &name,
+                               const PhaseCounters &phase) {
+    auto per_node = [&phase](uint64_t value) {
+        return phase.nodes ? static_cast<double>(value) / phase.nodes : 0;
+    };
+    double ipc = phase.values.at(0) ? static_cast<double>(phase.values.at(1)) /
+                                          phase.values.at(0)
+                                    : 0;
+    std::cout << std::left << std::setw(36) << "hw counters " + name
+              << std::right << std::setw(10) << phase.nodes << " nodes"
+              << std::fixed << std::setprecision(2) << std::setw(8) << ipc
+              << " IPC" << std::setw(10) << per_node(phase.values.at(0))
+              << " cycles/node" << std::setw(8) << per_node(phase.values.at(2))
+              << " cache-misses/node" << std::setw(8)
+              << per_node(phase.values.at(3)) << " branch-misses/node"
+              << std::endl;
+}
+
+static void benchHwCounters() {
+    const std::string name = "hw counters";
+    if (name.find(filter) == std::string::npos)
+        return;
+
+    PerfCounters counters;
+    if (!counters.isAvailable()) {
+        std::cout << "Hardware counters are not available" << std::endl;
+        return;
+    }
+
+    // Populate includes the rebuild of the expression trees, so we also
+    // measure the rebuild separately on the trees that weren't rebuilt yet.
+    // Nodes are the statements for the structure and the expression nodes
+    // for the rest of the phases.
+    PhaseCounters structure, populate, rebuild, emit;
+    Statistics &stats = Statistics::getInstance();
+    const size_t seeds_num = 20;
+    for (size_t seed = 1; seed <= seeds_num; ++seed) {
+        rand_val_gen->setSeed(seed);
+        std::shared_ptr<ScopeStmt> scope;
+        measurePhase(counters, structure, [&scope]() {
+            scope = ScopeStmt::generateStructure(std::make_shared<GenCtx>());
+        });
+        structure.nodes += scope->countStmts();
+
+        auto ctx = createPopulateCtx();
+        size_t expr_num = stats.getExprNum();
+        measurePhase(counters, populate,
+                     [&scope, &ctx]() { scope->populate(ctx); });
+        size_t test_nodes = stats.getExprNum() - expr_num;
+        populate.nodes += test_nodes;
+
+        // Non-zero arithmetic depth disables the rebuild in create()
+        auto gen_pol = std::make_shared<GenPolicy>(*ctx->getGenPolicy());
+        gen_pol->max_arith_depth++;
+        ctx->setGenPolicy(gen_pol);
+        ctx->incArithDepth();
+        expr_num = stats.getExprNum();
+        std::vector<std::shared_ptr<Expr>> exprs;
+        for (size_t i = 0; i < 100; ++i)
+            exprs.push_back(ArithmeticExpr::create(ctx));
+        ctx->decArithDepth();
+        rebuild.nodes += stats.getExprNum() - expr_num;
+        measurePhase(counters, rebuild, [&exprs]() {
+            for (auto &expr : exprs) {
+                expr->propagateType();
+                EvalCtx eval_ctx;
+                expr->rebuild(eval_ctx);
+            }
+        });
+
+        SourceWriter stream;
+        measurePhase(counters, emit, [&scope, &stream]() {
+            scope->emit(std::make_shared<EmitCtx>(), stream);
+        });
+        emit.nodes += test_nodes;
+        sink = sink + stream.size();
+    }
+
+    printPhaseCounters("structure", structure);
+    printPhaseCounters("populate", populate);
+    printPhaseCounters("rebuild", rebuild);
+    printPhaseCounters("emit", emit);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1)
+        filter = argv[1];
+    rand_val_gen = std::make_shared<RandValGen>(BENCH_SEED);
+
+    benchIRValue();
+    benchRandId();
+    benchArithExpr();
+    benchSymbolTable();
+    benchTypeInit();
+    benchEmit();
+    benchHwCounters();
+    return 0;
+}
@@ -18,6 +18,8 @@ limitations under the License.
 //////////////////////////////////////////////////////////////////////////////
 #include "context.h"
 
+#include <algorithm>
+#include <limits>
 #include <utility>
 
 using namespace yarpgen;
@@ -56,6 +58,35 @@ void SymbolTable::addArray(std::shared_ptr<Array> array) {
     array_dim_map[array_type->getDimensions().size()].push_back(array);
 }
 
+// The largest value that the iterator takes (or the maximal value of uint64_t
+// if it can be negative)
+static uint64_t getIterMaxIdx(const std::shared_ptr<Iterator> &iter) {
+    IRValue::AbsValue start = iter->getStartValue().getAbsValue();
+    IRValue::AbsValue end = iter->getEndValue().getAbsValue();
+    if (start.isNegative || end.isNegative)
+        return std::numeric_limits<uint64_t>::max();
+    return std::max(start.value, end.value);
+}
+
+void SymbolTable::addIters(std::vector<std::shared_ptr<Iterator>> iter) {
+    uint64_t max_idx = 0;
+    for (const auto &i : iter)
+        max_idx = std::max(max_idx, getIterMaxIdx(i));
+    iters.push_back(std::move(iter));
+    iters_max_idx.push_back(max_idx);
+}
+
+std::vector<std::shared_ptr<Iterator>>
+SymbolTable::getItersInRange(size_t level, size_t size) {
+    if (iters_max_idx.at(level) <= size)
+        return iters.at(level);
+    std::vector<std::shared_ptr<Iterator>> ret;
+    for (const auto &iter : iters.at(level))
+        if (getIterMaxIdx(iter) <= size)
+            ret.push_back(iter);
+    return ret;
+}
+
 std::vector<std::shared_ptr<Array>>
 SymbolTable::getArraysWithDimNum(size_t dim) {
     auto find_res = array_dim_map.find(dim);
@@ -70,21 +70,41 @@ class GenCtx {
     bool inside_foreach;
 };
 
-class SymbolTable {
+// Restores the generation policy of the context at the end of the scope, so
+// a subtree can use a modified policy without a copy of the whole context
+class GenPolicyGuard {
+  public:
+    explicit GenPolicyGuard(GenCtx &_ctx)
+        : ctx(_ctx), old_policy(_ctx.getGenPolicy()) {}
+    ~GenPolicyGuard() { ctx.setGenPolicy(std::move(old_policy)); }
+    GenPolicyGuard(const GenPolicyGuard &) = delete;
+    GenPolicyGuard &operator=(const GenPolicyGuard &) = delete;
+
+  private:
+    GenCtx &ctx;
+    std::shared_ptr<GenPolicy> old_policy;
+};
+
+class SymbolTable : private MemTracked<SymbolTable, MemKind::SYMBOL_TABLE> {
   public:
     void addVar(std::shared_ptr<ScalarVar> var) { vars.push_back(var); }
     void addArray(std::shared_ptr<Array> array);
-    void addIters(std::vector<std::shared_ptr<Iterator>> iter) {
-        iters.push_back(iter);
+    void addIters(std::vector<std::shared_ptr<Iterator>> iter);
+    void deleteLastIters() {
+        iters.pop_back();
+        iters_max_idx.pop_back();
     }
-    void deleteLastIters() { iters.pop_back(); }
 
     std::vector<std::shared_ptr<ScalarVar>> getVars() { return vars; }
     std::vector<std::shared_ptr<Array>> getArrays() { return arrays; }
     std::vector<std::shared_ptr<Array>> getArraysWithDimNum(size_t dim);
-    std::vector<std::vector<std::shared_ptr<Iterator>>> getIters() {
+    const std::vector<std::vector<std::shared_ptr<Iterator>>> &getIters() {
         return iters;
     }
+    // Iterators of the loop nest level that can be used as indices of the
+    // array dimension with the given size
+    std::vector<std::shared_ptr<Iterator>> getItersInRange(size_t level,
+                                                           size_t size);
 
     void addVarExpr(std::shared_ptr<ScalarVarUseExpr> var) {
         avail_vars.push_back(var);
@@ -99,12 +119,16 @@ class SymbolTable {
     std::vector<std::shared_ptr<Array>> arrays;
     std::map<size_t, std::vector<std::shared_ptr<Array>>> array_dim_map;
     std::vector<std::vector<std::shared_ptr<Iterator>>> iters;
+    // The largest value of the iterators for every loop nest level. Usually
+    // all of them fit, so we don't need to check the iterators one by one.
+    std::vector<uint64_t> iters_max_idx;
     std::vector<std::shared_ptr<ScalarVarUseExpr>> avail_vars;
 };
 
 // TODO: should we inherit it from Generation Context or should it be a separate
 // thing?
-class PopulateCtx : public GenCtx {
+class PopulateCtx : public GenCtx,
+                    private MemTracked<PopulateCtx, MemKind::POPULATE_CTX> {
   public:
     PopulateCtx();
     explicit PopulateCtx(std::shared_ptr<PopulateCtx> ctx);
@@ -151,9 +175,11 @@ class PopulateCtx : public GenCtx {
 };
 
 // TODO: maybe we need to inherit from some class
-class EmitCtx {
+class EmitCtx : private MemTracked<EmitCtx, MemKind::EMIT_CTX> {
   public:
-    EmitCtx() : ispc_types(false), sycl_access(false) {
+    EmitCtx()
+        : ispc_types(false), sycl_access(false), expr_temps(nullptr),
+          expr_temps_num(0), expr_depth(0) {
         emit_policy = std::make_shared<EmitPolicy>();
     }
     std::shared_ptr<EmitPolicy> getEmitPolicy() { return emit_policy; }
@@ -167,10 +193,32 @@ class EmitCtx {
     void setSYCLPrefix(std::string _val) { sycl_prefix = std::move(_val); }
     std::string getSYCLPrefix() { return sycl_prefix; }
 
+    // Expression statements move their deep subexpressions to temporaries
+    // (see --expr-temps). The declarations of the temporaries go to a
+    // separate buffer, so the statement can emit them first.
+    void setExprTemps(SourceWriter *_temps, Indent _offset) {
+        expr_temps = _temps;
+        expr_temps_offset = _offset;
+        expr_temps_num = 0;
+        expr_depth = 0;
+    }
+    SourceWriter *getExprTemps() { return expr_temps; }
+    Indent getExprTempsOffset() { return expr_temps_offset; }
+    std::string getNewExprTempName() {
+        return "tmp_" + std::to_string(expr_temps_num++);
+    }
+    // Number of the operators around the subexpression that we emit
+    void setExprDepth(size_t _val) { expr_depth = _val; }
+    size_t getExprDepth() { return expr_depth; }
+
   private:
     std::shared_ptr<EmitPolicy> emit_policy;
     bool ispc_types;
     bool sycl_access;
     std::string sycl_prefix;
+    SourceWriter *expr_temps;
+    Indent expr_temps_offset;
+    size_t expr_temps_num;
+    size_t expr_depth;
 };
 } // namespace yarpgen
@@ -104,6 +104,14 @@ std::shared_ptr<Array> Array::create(std::shared_ptr<PopulateCtx> ctx,
     return new_array;
 }
 
+Iterator::Iterator(std::string _name, std::shared_ptr<Type> _type,
+                   std::shared_ptr<Expr> _start, std::shared_ptr<Expr> _end,
+                   std::shared_ptr<Expr> _step, bool _degenerate)
+    : Data(std::move(_name), std::move(_type)), start(std::move(_start)),
+      end(std::move(_end)), step(std::move(_step)), degenerate(_degenerate) {
+    evalParameters();
+}
+
 void Iterator::setParameters(std::shared_ptr<Expr> _start,
                              std::shared_ptr<Expr> _end,
                              std::shared_ptr<Expr> _step) {
@@ -111,6 +119,21 @@ void Iterator::setParameters(std::shared_ptr<Expr> _start,
     start = std::move(_start);
     end = std::move(_end);
     step = std::move(_step);
+    evalParameters();
+}
+
+void Iterator::evalParameters() {
+    auto eval_param = [](std::shared_ptr<Expr> &expr) -> IRValue {
+        EvalCtx eval_ctx;
+        auto eval_res = expr->evaluate(eval_ctx);
+        assert(eval_res->isScalarVar() &&
+               "Iterator should have a scalar value");
+        return std::static_pointer_cast<ScalarVar>(eval_res)
+            ->getCurrentValue();
+    };
+    start_val = eval_param(start);
+    end_val = eval_param(end);
+    step_val = eval_param(step);
 }
 
 std::shared_ptr<Iterator> Iterator::create(std::shared_ptr<PopulateCtx> ctx,
@@ -161,9 +184,11 @@ void Iterator::dbgDump() {
     std::cout << name << std::endl;
     type->dbgDump();
     auto emit_ctx = std::make_shared<EmitCtx>();
-    start->emit(emit_ctx, std::cout);
-    end->emit(emit_ctx, std::cout);
-    end->emit(emit_ctx, std::cout);
+    SourceWriter stream;
+    start->emit(emit_ctx, stream);
+    end->emit(emit_ctx, stream);
+    end->emit(emit_ctx, stream);
+    stream.writeTo(std::cout);
 }
 
 // This function bring the value of an expression that used in iterator
@@ -310,4 +335,5 @@ void Iterator::populate(std::shared_ptr<PopulateCtx> ctx) {
     start = populate_impl(type, start);
     end = populate_impl(type, end);
     step = populate_impl(type, step);
+    evalParameters();
 }
@@ -34,7 +34,8 @@ class Data {
   public:
     Data(std::string _name, std::shared_ptr<Type> _type)
         : name(std::move(_name)), type(std::move(_type)),
-          ub_code(UBKind::Uninit), is_dead(true), alignment(0) {}
+          ub_code(UBKind::Uninit), is_dead(true), alignment(0),
+          pass_as_param(false), use_assert(false) {}
     virtual ~Data() = default;
 
     virtual std::string getName(std::shared_ptr<EmitCtx> ctx) { return name; }
@@ -61,6 +62,12 @@ class Data {
     void setAlignment(size_t _alignment) { alignment = _alignment; }
     size_t getAlignment() { return alignment; }
 
+    void setPassAsParam(bool val) { pass_as_param = val; }
+    bool getPassAsParam() { return pass_as_param; }
+
+    void setUseAssert(bool val) { use_assert = val; }
+    bool getUseAssert() { return use_assert; }
+
   protected:
     template <typename T> static std::shared_ptr<Data> makeVaryingImpl(T val) {
         auto ret = std::make_shared<T>(val);
@@ -78,13 +85,20 @@ class Data {
     // Sometimes we create more variables than we use.
     // They create a lot of dead code in the test, so we need to prune them.
     bool is_dead;
+    // Emission decisions. They are made before the emission, so it doesn't
+    // need to make any random decisions.
     size_t alignment;
+    // Input data can be passed to the test function as a parameter
+    bool pass_as_param;
+    // Output data can be checked with assert instead of hashing
+    bool use_assert;
 };
 
 // Shorthand to make it simpler
 using DataType = std::shared_ptr<Data>;
 
-class ScalarVar : public Data {
+class ScalarVar : public Data,
+                  private MemTracked<ScalarVar, MemKind::SCALAR_VAR> {
   public:
     ScalarVar(std::string _name, const std::shared_ptr<IntegralType> &_type,
               IRValue _init_value)
@@ -120,7 +134,8 @@ class ScalarVar : public Data {
     bool changed;
 };
 
-class Array : public Data {
+class Array : public Data,
+              private MemTracked<Array, MemKind::ARRAY> {
   public:
     Array(std::string _name, const std::shared_ptr<ArrayType> &_type,
           std::shared_ptr<Data> _val);
@@ -157,14 +172,12 @@ class Array : public Data {
 
 class Expr;
 
-class Iterator : public Data {
+class Iterator : public Data,
+                 private MemTracked<Iterator, MemKind::ITERATOR> {
   public:
     Iterator(std::string _name, std::shared_ptr<Type> _type,
              std::shared_ptr<Expr> _start, std::shared_ptr<Expr> _end,
-             std::shared_ptr<Expr> _step, bool _degenerate)
-        : Data(std::move(_name), std::move(_type)), start(std::move(_start)),
-          end(std::move(_end)), step(std::move(_step)),
-          degenerate(_degenerate) {}
+             std::shared_ptr<Expr> _step, bool _degenerate);
 
     bool isIterator() final { return true; }
     DataKind getKind() final { return DataKind::ITER; }
@@ -174,6 +187,11 @@ class Iterator : public Data {
     std::shared_ptr<Expr> getStep() { return step; }
     void setParameters(std::shared_ptr<Expr> _start, std::shared_ptr<Expr> _end,
                        std::shared_ptr<Expr> _step);
+    // Values of the parameters are calculated every time the parameters
+    // change, so nobody needs to evaluate them later.
+    IRValue getStartValue() { return start_val; }
+    IRValue getEndValue() { return end_val; }
+    IRValue getStepValue() { return step_val; }
     bool isDegenerate() { return degenerate; }
 
     void dbgDump() final;
@@ -193,7 +211,12 @@ class Iterator : public Data {
     std::shared_ptr<Expr> start;
     std::shared_ptr<Expr> end;
     std::shared_ptr<Expr> step;
+    IRValue start_val;
+    IRValue end_val;
+    IRValue step_val;
     bool degenerate;
+
+    void evalParameters();
 };
 
 } // namespace yarpgen
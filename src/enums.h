@@ -157,6 +157,24 @@ enum class OptionKind {
     OUT_DIR,
     PARAM_SHUFFLE,
     EXPL_LOOP_PARAM,
+    EMIT_THREADS,
+    FUNC_NUM,
+    ARCHIVE,
+    CHECKSUM_MODE,
+    ARRAY_INIT,
+    MAX_DYN_OPS,
+    MAX_COMPILE_COST,
+    STATS_JSON,
+    MEM_REPORT,
+    STMT_NUM_LIM,
+    MAX_ARITH_DEPTH,
+    TRACE,
+    STREAM_EMIT,
+    UB_FREE_OPS,
+    DEADLINE_MS,
+    MEM_BUDGET,
+    COMPACT_EMIT,
+    EXPR_TEMPS,
     MAX_OPTION_ID
 };
 
@@ -164,6 +182,12 @@ enum class OptionLevel { NONE, SOME, ALL, MAX_OPTION_LEVEL };
 
 enum class LangStd { C, CXX, ISPC, SYCL, MAX_LANG_STD };
 
+// Per-element hashing of output arrays or a single bulk hash of the storage
+enum class ChecksumMode { ELEM, BULK, MAX_CHECKSUM_MODE };
+
+// Element by element loops or the cheapest way to fill arrays with a value
+enum class ArrayInitMode { LOOP, FAST, MAX_ARRAY_INIT_MODE };
+
 enum class AlignmentSize {
     A16,
     A32,
@@ -206,4 +230,53 @@ enum class SpecialConst {
     MAX_SPECIAL_CONST
 };
 
+// Phases of the generation that we measure with timers. Phases can overlap
+// (e.g., type interning happens during population).
+enum class GenPhase {
+    TOTAL,
+    GEN_STRUCTURE,
+    POPULATE,
+    REBUILD,
+    TYPE_INIT,
+    EMIT_EXT_DECL,
+    EMIT_DECL,
+    EMIT_INIT,
+    EMIT_CHECK,
+    EMIT_MAIN,
+    EMIT_TEST,
+    WRITE,
+    MAX_GEN_PHASE
+};
+
+// Objects that we count for the memory report
+enum class MemKind {
+    CONST_EXPR,
+    SCALAR_VAR_USE_EXPR,
+    ARRAY_USE_EXPR,
+    ITER_USE_EXPR,
+    TYPE_CAST_EXPR,
+    UNARY_EXPR,
+    BINARY_EXPR,
+    TERNARY_EXPR,
+    SUBSCRIPT_EXPR,
+    ASSIGN_EXPR,
+    CALL_EXPR,
+    EXPR_STMT,
+    DECL_STMT,
+    STMT_BLOCK, // Scopes included
+    LOOP_SEQ_STMT,
+    LOOP_NEST_STMT,
+    IF_ELSE_STMT,
+    STUB_STMT,
+    SCALAR_VAR,
+    ARRAY,
+    ITERATOR,
+    INTEGRAL_TYPE,
+    ARRAY_TYPE,
+    POPULATE_CTX,
+    EMIT_CTX,
+    SYMBOL_TABLE,
+    MAX_MEM_KIND
+};
+
 } // namespace yarpgen
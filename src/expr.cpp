@@ -20,6 +20,7 @@ limitations under the License.
 #include "expr.h"
 #include "context.h"
 #include "options.h"
+#include "statistics.h"
 #include <algorithm>
 #include <utility>
 
@@ -48,10 +49,13 @@ ConstantExpr::ConstantExpr(IRValue _value) {
 
 Expr::EvalResType ConstantExpr::evaluate(EvalCtx &ctx) { return value; }
 
-Expr::EvalResType ConstantExpr::rebuild(EvalCtx &ctx) { return evaluate(ctx); }
+Expr::EvalResType ConstantExpr::rebuild(EvalCtx &ctx) {
+    ScopedTraceEvent trace("rebuild", getKind());
+    return evaluate(ctx);
+}
 
-void ConstantExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                        std::string offset) {
+void ConstantExpr::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                        Indent offset) {
     assert(value->isScalarVar() &&
            "ConstExpr can represent only scalar constant");
     auto scalar_var = std::static_pointer_cast<ScalarVar>(value);
@@ -283,6 +287,7 @@ Expr::EvalResType ScalarVarUseExpr::evaluate(EvalCtx &ctx) {
 }
 
 Expr::EvalResType ScalarVarUseExpr::rebuild(EvalCtx &ctx) {
+    ScopedTraceEvent trace("rebuild", getKind());
     return evaluate(ctx);
 }
 
@@ -330,7 +335,10 @@ Expr::EvalResType ArrayUseExpr::evaluate(EvalCtx &ctx) {
     return value;
 }
 
-Expr::EvalResType ArrayUseExpr::rebuild(EvalCtx &ctx) { return evaluate(ctx); }
+Expr::EvalResType ArrayUseExpr::rebuild(EvalCtx &ctx) {
+    ScopedTraceEvent trace("rebuild", getKind());
+    return evaluate(ctx);
+}
 
 std::shared_ptr<IterUseExpr> IterUseExpr::init(std::shared_ptr<Data> _iter) {
     assert(_iter->isIterator() && "IterUseExpr accepts only iterators!");
@@ -365,7 +373,10 @@ Expr::EvalResType IterUseExpr::evaluate(EvalCtx &ctx) {
     return value;
 }
 
-Expr::EvalResType IterUseExpr::rebuild(EvalCtx &ctx) { return evaluate(ctx); }
+Expr::EvalResType IterUseExpr::rebuild(EvalCtx &ctx) {
+    ScopedTraceEvent trace("rebuild", getKind());
+    return evaluate(ctx);
+}
 
 TypeCastExpr::TypeCastExpr(std::shared_ptr<Expr> _expr,
                            std::shared_ptr<Type> _to_type, bool _is_implicit)
@@ -382,12 +393,74 @@ bool TypeCastExpr::propagateType() {
     return true;
 }
 
-void TypeCastExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                        std::string offset) {
+// Emits the operand of an operator or a call in parentheses (if asked).
+// Operands that are nested too deep go to the temporaries of the expression
+// statement (see --expr-temps).
+static void emitOperand(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                        const std::shared_ptr<Expr> &operand, bool parens) {
+    size_t depth = ctx->getExprDepth();
+    SourceWriter *temps = ctx->getExprTemps();
+    IRNodeKind kind = operand->getKind();
+    bool is_operator = kind == IRNodeKind::TYPE_CAST ||
+                       kind == IRNodeKind::UNARY ||
+                       kind == IRNodeKind::BINARY ||
+                       kind == IRNodeKind::TERNARY;
+    // The operand is at depth + 2, counting the root of the expression
+    if (temps && is_operator &&
+        depth + 1 >= Options::getInstance().getExprTemps()) {
+        static const size_t INIT_CAPACITY = 1 << 8;
+        SourceWriter init(INIT_CAPACITY);
+        ctx->setExprDepth(0);
+        operand->emit(ctx, init);
+        ctx->setExprDepth(depth);
+
+        std::string name = ctx->getNewExprTempName();
+        *temps << ctx->getExprTempsOffset()
+               << operand->getValue()->getType()->getName(ctx) << " " << name
+               << " = " << init << ";\n";
+        stream << name;
+        return;
+    }
+
+    ctx->setExprDepth(depth + 1);
+    if (parens)
+        stream << "(";
+    operand->emit(ctx, stream);
+    if (parens)
+        stream << ")";
+    ctx->setExprDepth(depth);
+}
+
+// Operands of the prefix operators (unary and casts) need parentheses unless
+// they bind tighter. Constants can start with a minus, so we don't want to
+// glue them to another minus.
+static bool needParensAsPrefixOperand(const std::shared_ptr<Expr> &operand,
+                                      bool is_cast) {
+    switch (operand->getKind()) {
+        case IRNodeKind::BINARY:
+        case IRNodeKind::TERNARY:
+        case IRNodeKind::ASSIGN:
+            return true;
+        case IRNodeKind::UNARY:
+        case IRNodeKind::CONST:
+            return !is_cast;
+        default:
+            return false;
+    }
+}
+
+void TypeCastExpr::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                        Indent offset) {
+    if (Options::getInstance().getCompactEmit()) {
+        stream << "(" << to_type->getName(ctx) << ") ";
+        emitOperand(ctx, stream, expr, needParensAsPrefixOperand(expr, true));
+        return;
+    }
+
     // TODO: add switch for C++ style conversions and switch for implicit casts
     stream << "((" << (is_implicit ? "/* implicit */" : "")
            << to_type->getName(ctx) << ") ";
-    expr->emit(ctx, stream);
+    emitOperand(ctx, stream, expr, false);
     stream << ")";
 }
 
@@ -456,6 +529,7 @@ Expr::EvalResType TypeCastExpr::evaluate(EvalCtx &ctx) {
 }
 
 Expr::EvalResType TypeCastExpr::rebuild(EvalCtx &ctx) {
+    ScopedTraceEvent trace("rebuild", getKind());
     propagateType();
     expr->rebuild(ctx);
     std::shared_ptr<Data> eval_res = evaluate(ctx);
@@ -468,7 +542,12 @@ Expr::EvalResType TypeCastExpr::rebuild(EvalCtx &ctx) {
         return eval_res;
     }
 
+    Statistics &stats = Statistics::getInstance();
+    stats.addUB(eval_scalar_res->getCurrentValue().getUBCode());
+    stats.addCastRewrite();
+
     do {
+        stats.addReevaluation();
         eval_res = evaluate(ctx);
         eval_scalar_res = std::static_pointer_cast<ScalarVar>(eval_res);
         if (!eval_scalar_res->getCurrentValue().hasUB())
@@ -530,6 +609,10 @@ void ArithmeticExpr::arithConv(std::shared_ptr<Expr> &lhs,
     auto rhs_type =
         std::static_pointer_cast<IntegralType>(rhs->getValue()->getType());
 
+    // Integral types are interned, so the same type is the same object
+    if (lhs_type == rhs_type)
+        return;
+
     // C++ draft N4713: 8.3 Usual arithmetic conversions [expr.arith.conv]
     // 1.5.1
     if (lhs_type->getIntTypeId() == rhs_type->getIntTypeId())
@@ -631,41 +714,75 @@ void ArithmeticExpr::varyingPromotion(std::shared_ptr<Expr> &lhs,
         return;
 }
 
-std::shared_ptr<Expr> ArithmeticExpr::create(std::shared_ptr<PopulateCtx> ctx) {
-    auto gen_pol = ctx->getGenPolicy();
-    std::shared_ptr<Expr> new_node;
-    ctx->incArithDepth();
-    auto active_ctx = std::make_shared<PopulateCtx>(*ctx);
-    if (active_ctx->getArithDepth() == gen_pol->max_arith_depth) {
-        // We can have only constants, variables and arrays as leaves
-        std::vector<Probability<IRNodeKind>> new_node_distr;
-        for (auto &item : gen_pol->arith_node_distr) {
-            if (item.getId() == IRNodeKind::CONST ||
-                item.getId() == IRNodeKind::SCALAR_VAR_USE ||
-                item.getId() == IRNodeKind::ARRAY_USE)
-                new_node_distr.push_back(item);
-        }
+// Compile cost of a single expression node (see Statistics for the model)
+static uint64_t getNodeCost(std::shared_ptr<PopulateCtx> ctx, IRNodeKind kind) {
+    uint64_t cost = 1 + ctx->getLoopDepth();
+    if (kind == IRNodeKind::SUBSCRIPT)
+        cost *= 2;
+    return cost;
+}
+
+// Returns a copy of the policy that allows only the leaves. Siblings usually
+// share the policy of their parent, so we keep the last copy instead of
+// making a new one for every leaf. Policies are never changed in place.
+static std::shared_ptr<GenPolicy>
+getLeavesPolicy(const std::shared_ptr<GenPolicy> &gen_pol) {
+    static std::weak_ptr<GenPolicy> last_src;
+    static std::shared_ptr<GenPolicy> last_leaves;
+    if (last_src.lock() == gen_pol)
+        return last_leaves;
 
-        bool zero_prob = true;
+    // We can have only constants, variables and arrays as leaves
+    std::vector<Probability<IRNodeKind>> new_node_distr;
+    for (auto &item : gen_pol->arith_node_distr) {
+        if (item.getId() == IRNodeKind::CONST ||
+            item.getId() == IRNodeKind::SCALAR_VAR_USE ||
+            item.getId() == IRNodeKind::ARRAY_USE)
+            new_node_distr.push_back(item);
+    }
+
+    bool zero_prob = true;
+    for (auto &item : new_node_distr) {
+        if (item.getProb())
+            zero_prob = false;
+    }
+
+    // If after the option shuffling probability of all appropriate leaves
+    // was set to zero, we need a backup-plan. We just bump it to some
+    // value.
+    if (zero_prob) {
         for (auto &item : new_node_distr) {
-            if (item.getProb())
-                zero_prob = false;
+            item.increaseProb(GenPolicy::leaves_prob_bump);
         }
+    }
 
-        // If after the option shuffling probability of all appropriate leaves
-        // was set to zero, we need a backup-plan. We just bump it to some
-        // value.
-        if (zero_prob) {
-            for (auto &item : new_node_distr) {
-                item.increaseProb(GenPolicy::leaves_prob_bump);
-            }
-        }
+    last_leaves = std::make_shared<GenPolicy>(*gen_pol);
+    last_leaves->arith_node_distr = new_node_distr;
+    last_src = gen_pol;
+    return last_leaves;
+}
 
-        auto new_gen_policy = std::make_shared<GenPolicy>(*gen_pol);
-        new_gen_policy->arith_node_distr = new_node_distr;
-        active_ctx->setGenPolicy(new_gen_policy);
-    }
-    gen_pol = active_ctx->getGenPolicy();
+std::shared_ptr<Expr> ArithmeticExpr::create(std::shared_ptr<PopulateCtx> ctx) {
+    ScopedTraceEvent trace("create");
+    auto gen_pol = ctx->getGenPolicy();
+    std::shared_ptr<Expr> new_node;
+
+    Options &options = Options::getInstance();
+    Statistics &stats = Statistics::getInstance();
+    uint64_t cost_before = stats.getCompileCost();
+    bool over_budget = (options.useCompileCostBudget() &&
+                        cost_before >= options.getMaxCompileCost()) ||
+                       stats.pastDeadline() || stats.overMemBudget();
+
+    ctx->incArithDepth();
+    // The subtree may use a modified policy, the rest of the context is
+    // the same
+    GenPolicyGuard policy_guard(*ctx);
+    if (ctx->getArithDepth() >=
+            stats.shrinkForMemBudget(gen_pol->max_arith_depth) ||
+        over_budget)
+        ctx->setGenPolicy(getLeavesPolicy(gen_pol));
+    gen_pol = ctx->getGenPolicy();
 
     bool apply_similar_op =
         rand_val_gen->getRandId(gen_pol->apply_similar_op_distr);
@@ -673,7 +790,7 @@ std::shared_ptr<Expr> ArithmeticExpr::create(std::shared_ptr<PopulateCtx> ctx) {
         auto new_gen_policy = std::make_shared<GenPolicy>(*gen_pol);
         gen_pol = new_gen_policy;
         gen_pol->chooseAndApplySimilarOp();
-        active_ctx->setGenPolicy(gen_pol);
+        ctx->setGenPolicy(gen_pol);
     }
 
     bool apply_const_use =
@@ -682,48 +799,55 @@ std::shared_ptr<Expr> ArithmeticExpr::create(std::shared_ptr<PopulateCtx> ctx) {
         auto new_gen_policy = std::make_shared<GenPolicy>(*gen_pol);
         gen_pol = new_gen_policy;
         gen_pol->chooseAndApplyConstUse();
-        active_ctx->setGenPolicy(gen_pol);
+        ctx->setGenPolicy(gen_pol);
     }
 
     IRNodeKind node_kind = rand_val_gen->getRandId(gen_pol->arith_node_distr);
 
     if (node_kind == IRNodeKind::CONST) {
-        new_node = ConstantExpr::create(active_ctx);
+        new_node = ConstantExpr::create(ctx);
     }
     else if (node_kind == IRNodeKind::SCALAR_VAR_USE ||
-             ((active_ctx->getExtInpSymTable()->getArrays().empty() ||
-               active_ctx->getLocalSymTable()->getIters().empty()) &&
+             ((ctx->getExtInpSymTable()->getArrays().empty() ||
+               ctx->getLocalSymTable()->getIters().empty()) &&
               node_kind == IRNodeKind::SUBSCRIPT)) {
-        auto new_scalar_var_use_expr = ScalarVarUseExpr::create(active_ctx);
+        auto new_scalar_var_use_expr = ScalarVarUseExpr::create(ctx);
         new_scalar_var_use_expr->setIsDead(false);
         new_node = new_scalar_var_use_expr;
     }
     else if (node_kind == IRNodeKind::SUBSCRIPT) {
-        auto new_subs_expr = SubscriptExpr::create(active_ctx);
+        auto new_subs_expr = SubscriptExpr::create(ctx);
         new_subs_expr->setIsDead(false);
         new_node = new_subs_expr;
     }
     else if (node_kind == IRNodeKind::TYPE_CAST) {
-        new_node = TypeCastExpr::create(active_ctx);
+        new_node = TypeCastExpr::create(ctx);
     }
     else if (node_kind == IRNodeKind::UNARY) {
-        new_node = UnaryExpr::create(active_ctx);
+        new_node = UnaryExpr::create(ctx);
     }
     else if (node_kind == IRNodeKind::BINARY) {
-        new_node = BinaryExpr::create(active_ctx);
+        new_node = BinaryExpr::create(ctx);
     }
     else if (node_kind == IRNodeKind::CALL) {
-        new_node = LibCallExpr::create(active_ctx);
+        new_node = LibCallExpr::create(ctx);
     }
     else if (node_kind == IRNodeKind::TERNARY) {
-        new_node = TernaryExpr::create(active_ctx);
+        new_node = TernaryExpr::create(ctx);
     }
     else
         ERROR("Bad node kind");
+    trace.setKind(new_node->getKind());
+
+    // Children are already counted, so the difference is the cost of the
+    // whole subtree
+    stats.addExpr(getNodeCost(ctx, new_node->getKind()));
+    new_node->setComplexity(stats.getCompileCost() - cost_before);
 
     ctx->decArithDepth();
 
     if (ctx->getArithDepth() == 0) {
+        ScopedTimer timer(GenPhase::REBUILD);
         new_node->propagateType();
         EvalCtx eval_ctx;
         new_node->rebuild(eval_ctx);
@@ -750,30 +874,36 @@ bool UnaryExpr::propagateType() {
     return true;
 }
 
-Expr::EvalResType UnaryExpr::evaluate(EvalCtx &ctx) {
-    propagateType();
-    EvalResType eval_res = arg->evaluate(ctx);
-    assert(eval_res->getKind() == DataKind::VAR &&
-           "Unary operations are supported for Scalar Variables only");
-    auto scalar_arg = std::static_pointer_cast<ScalarVar>(arg->getValue());
-    IRValue new_val;
+// Current value of the scalar variable that holds the evaluation result
+static IRValue getCurrentValue(const std::shared_ptr<Data> &data) {
+    return std::static_pointer_cast<ScalarVar>(data)->getCurrentValue();
+}
+
+// Applies the operator to the value of the converted operand
+static IRValue applyUnaryOp(UnaryOp op, IRValue arg) {
     switch (op) {
         case UnaryOp::PLUS:
-            new_val = +scalar_arg->getCurrentValue();
-            break;
+            return +arg;
         case UnaryOp::NEGATE:
-            new_val = -scalar_arg->getCurrentValue();
-            break;
+            return -arg;
         case UnaryOp::LOG_NOT:
-            new_val = !scalar_arg->getCurrentValue();
-            break;
+            return !arg;
         case UnaryOp::BIT_NOT:
-            new_val = ~scalar_arg->getCurrentValue();
-            break;
+            return ~arg;
         case UnaryOp::MAX_UN_OP:
             ERROR("Bad unary operator");
             break;
     }
+    return IRValue();
+}
+
+Expr::EvalResType UnaryExpr::evaluate(EvalCtx &ctx) {
+    propagateType();
+    EvalResType eval_res = arg->evaluate(ctx);
+    assert(eval_res->getKind() == DataKind::VAR &&
+           "Unary operations are supported for Scalar Variables only");
+    auto scalar_arg = std::static_pointer_cast<ScalarVar>(arg->getValue());
+    IRValue new_val = applyUnaryOp(op, scalar_arg->getCurrentValue());
     assert(scalar_arg->getType()->isIntType() &&
            "Unary operations are supported for Scalar Variables of Integral "
            "Types only");
@@ -786,6 +916,7 @@ Expr::EvalResType UnaryExpr::evaluate(EvalCtx &ctx) {
 }
 
 Expr::EvalResType UnaryExpr::rebuild(EvalCtx &ctx) {
+    ScopedTraceEvent trace("rebuild", getKind());
     propagateType();
     arg->rebuild(ctx);
     EvalResType eval_res = evaluate(ctx);
@@ -798,6 +929,10 @@ Expr::EvalResType UnaryExpr::rebuild(EvalCtx &ctx) {
         return value;
     }
 
+    Statistics &stats = Statistics::getInstance();
+    stats.addUB(eval_scalar_res->getCurrentValue().getUBCode());
+    stats.addUnaryRewrite(op);
+
     if (op == UnaryOp::NEGATE) {
         op = UnaryOp::PLUS;
     }
@@ -806,6 +941,7 @@ Expr::EvalResType UnaryExpr::rebuild(EvalCtx &ctx) {
     }
 
     do {
+        stats.addReevaluation();
         eval_res = evaluate(ctx);
         eval_scalar_res = std::static_pointer_cast<ScalarVar>(eval_res);
         if (!eval_scalar_res->getCurrentValue().hasUB())
@@ -817,9 +953,12 @@ Expr::EvalResType UnaryExpr::rebuild(EvalCtx &ctx) {
     return value;
 }
 
-void UnaryExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                     std::string offset) {
-    stream << offset << "(";
+void UnaryExpr::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                     Indent offset) {
+    bool compact = Options::getInstance().getCompactEmit();
+    stream << offset;
+    if (!compact)
+        stream << "(";
     switch (op) {
         case UnaryOp::PLUS:
             stream << "+";
@@ -837,15 +976,50 @@ void UnaryExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
             ERROR("Bad unary operator");
             break;
     }
-    stream << "(";
-    arg->emit(ctx, stream);
-    stream << "))";
+    emitOperand(ctx, stream, arg,
+                !compact || needParensAsPrefixOperand(arg, false));
+    if (!compact)
+        stream << ")";
 }
 std::shared_ptr<UnaryExpr> UnaryExpr::create(std::shared_ptr<PopulateCtx> ctx) {
     auto gen_pol = ctx->getGenPolicy();
     UnaryOp op = rand_val_gen->getRandId(gen_pol->unary_op_distr);
     auto expr = ArithmeticExpr::create(ctx);
-    return std::make_shared<UnaryExpr>(op, expr);
+    auto new_node = std::make_shared<UnaryExpr>(op, expr);
+    if (Options::getInstance().getUBFreeOps() &&
+        getCurrentValue(new_node->getValue()).hasUB() &&
+        new_node->pickUBFreeOp(gen_pol->unary_op_distr))
+        Statistics::getInstance().addAvoidedUB();
+    return new_node;
+}
+
+// Operators with the same group of the operand conversions
+// (see propagateType). Values of the converted operands don't depend on the
+// operator within the group.
+enum class OperandConv { PROMOTION, ARITH_CONV, TO_BOOL };
+
+static OperandConv getOperandConv(UnaryOp op) {
+    return op == UnaryOp::LOG_NOT ? OperandConv::TO_BOOL
+                                  : OperandConv::PROMOTION;
+}
+
+bool UnaryExpr::pickUBFreeOp(const std::vector<Probability<UnaryOp>> &distr) {
+    IRValue arg_val = getCurrentValue(arg->getValue());
+    std::vector<Probability<UnaryOp>> ub_free_ops;
+    for (const auto &prob : distr) {
+        if (prob.getProb() == 0 ||
+            getOperandConv(prob.getId()) != getOperandConv(op))
+            continue;
+        if (!applyUnaryOp(prob.getId(), arg_val).hasUB())
+            ub_free_ops.push_back(prob);
+    }
+    if (ub_free_ops.empty())
+        return false;
+
+    op = rand_val_gen->getRandId(ub_free_ops);
+    EvalCtx ctx;
+    evaluate(ctx);
+    return true;
 }
 
 UnaryExpr::UnaryExpr(UnaryOp _op, std::shared_ptr<Expr> _expr)
@@ -900,83 +1074,69 @@ bool BinaryExpr::propagateType() {
     return true;
 }
 
-Expr::EvalResType BinaryExpr::evaluate(EvalCtx &ctx) {
-    propagateType();
-    if (lhs->getValue()->getKind() != DataKind::VAR ||
-        rhs->getValue()->getKind() != DataKind::VAR) {
-        ERROR("Binary operations are supported only for scalar variables");
-    }
-
-    lhs->evaluate(ctx);
-    rhs->evaluate(ctx);
-
-    auto lhs_scalar_var = std::static_pointer_cast<ScalarVar>(lhs->getValue());
-    auto rhs_scalar_var = std::static_pointer_cast<ScalarVar>(rhs->getValue());
-
-    IRValue lhs_val = lhs_scalar_var->getCurrentValue();
-    IRValue rhs_val = rhs_scalar_var->getCurrentValue();
-
-    IRValue new_val(lhs_val.getIntTypeID());
-
+// Applies the operator to the values of the converted operands
+static IRValue applyBinaryOp(BinaryOp op, IRValue lhs, IRValue rhs) {
     switch (op) {
         case BinaryOp::ADD:
-            new_val = lhs_val + rhs_val;
-            break;
+            return lhs + rhs;
         case BinaryOp::SUB:
-            new_val = lhs_val - rhs_val;
-            break;
+            return lhs - rhs;
         case BinaryOp::MUL:
-            new_val = lhs_val * rhs_val;
-            break;
+            return lhs * rhs;
         case BinaryOp::DIV:
-            new_val = lhs_val / rhs_val;
-            break;
+            return lhs / rhs;
         case BinaryOp::MOD:
-            new_val = lhs_val % rhs_val;
-            break;
+            return lhs % rhs;
         case BinaryOp::LT:
-            new_val = lhs_val < rhs_val;
-            break;
+            return lhs < rhs;
         case BinaryOp::GT:
-            new_val = lhs_val > rhs_val;
-            break;
+            return lhs > rhs;
         case BinaryOp::LE:
-            new_val = lhs_val <= rhs_val;
-            break;
+            return lhs <= rhs;
         case BinaryOp::GE:
-            new_val = lhs_val >= rhs_val;
-            break;
+            return lhs >= rhs;
         case BinaryOp::EQ:
-            new_val = lhs_val == rhs_val;
-            break;
+            return lhs == rhs;
         case BinaryOp::NE:
-            new_val = lhs_val != rhs_val;
-            break;
+            return lhs != rhs;
         case BinaryOp::LOG_AND:
-            new_val = lhs_val && rhs_val;
-            break;
+            return lhs && rhs;
         case BinaryOp::LOG_OR:
-            new_val = lhs_val || rhs_val;
-            break;
+            return lhs || rhs;
         case BinaryOp::BIT_AND:
-            new_val = lhs_val & rhs_val;
-            break;
+            return lhs & rhs;
         case BinaryOp::BIT_OR:
-            new_val = lhs_val | rhs_val;
-            break;
+            return lhs | rhs;
         case BinaryOp::BIT_XOR:
-            new_val = lhs_val ^ rhs_val;
-            break;
+            return lhs ^ rhs;
         case BinaryOp::SHL:
-            new_val = lhs_val << rhs_val;
-            break;
+            return lhs << rhs;
         case BinaryOp::SHR:
-            new_val = lhs_val >> rhs_val;
-            break;
+            return lhs >> rhs;
         case BinaryOp::MAX_BIN_OP:
             ERROR("Bad operator code");
             break;
     }
+    return IRValue(lhs.getIntTypeID());
+}
+
+Expr::EvalResType BinaryExpr::evaluate(EvalCtx &ctx) {
+    propagateType();
+    if (lhs->getValue()->getKind() != DataKind::VAR ||
+        rhs->getValue()->getKind() != DataKind::VAR) {
+        ERROR("Binary operations are supported only for scalar variables");
+    }
+
+    lhs->evaluate(ctx);
+    rhs->evaluate(ctx);
+
+    auto lhs_scalar_var = std::static_pointer_cast<ScalarVar>(lhs->getValue());
+    auto rhs_scalar_var = std::static_pointer_cast<ScalarVar>(rhs->getValue());
+
+    IRValue lhs_val = lhs_scalar_var->getCurrentValue();
+    IRValue rhs_val = rhs_scalar_var->getCurrentValue();
+
+    IRValue new_val = applyBinaryOp(op, lhs_val, rhs_val);
 
     value = std::make_shared<ScalarVar>(
         "",
@@ -987,6 +1147,7 @@ Expr::EvalResType BinaryExpr::evaluate(EvalCtx &ctx) {
 }
 
 Expr::EvalResType BinaryExpr::rebuild(EvalCtx &ctx) {
+    ScopedTraceEvent trace("rebuild", getKind());
     propagateType();
     lhs->rebuild(ctx);
     rhs->rebuild(ctx);
@@ -1001,6 +1162,9 @@ Expr::EvalResType BinaryExpr::rebuild(EvalCtx &ctx) {
     }
 
     UBKind ub = eval_scalar_res->getCurrentValue().getUBCode();
+    Statistics &stats = Statistics::getInstance();
+    stats.addUB(ub);
+    stats.addBinaryRewrite(op);
 
     switch (op) {
         case BinaryOp::ADD:
@@ -1119,6 +1283,7 @@ Expr::EvalResType BinaryExpr::rebuild(EvalCtx &ctx) {
     }
 
     do {
+        stats.addReevaluation();
         eval_res = evaluate(ctx);
         eval_scalar_res = std::static_pointer_cast<ScalarVar>(eval_res);
         if (!eval_scalar_res->getCurrentValue().hasUB())
@@ -1130,11 +1295,93 @@ Expr::EvalResType BinaryExpr::rebuild(EvalCtx &ctx) {
     return eval_res;
 }
 
-void BinaryExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                      std::string offset) {
-    stream << offset << "((";
-    lhs->emit(ctx, stream);
-    stream << ")";
+// C precedence of the binary operators (bigger binds tighter)
+static int getPrecedence(BinaryOp op) {
+    switch (op) {
+        case BinaryOp::MUL:
+        case BinaryOp::DIV:
+        case BinaryOp::MOD:
+            return 10;
+        case BinaryOp::ADD:
+        case BinaryOp::SUB:
+            return 9;
+        case BinaryOp::SHL:
+        case BinaryOp::SHR:
+            return 8;
+        case BinaryOp::LT:
+        case BinaryOp::GT:
+        case BinaryOp::LE:
+        case BinaryOp::GE:
+            return 7;
+        case BinaryOp::EQ:
+        case BinaryOp::NE:
+            return 6;
+        case BinaryOp::BIT_AND:
+            return 5;
+        case BinaryOp::BIT_XOR:
+            return 4;
+        case BinaryOp::BIT_OR:
+            return 3;
+        case BinaryOp::LOG_AND:
+            return 2;
+        case BinaryOp::LOG_OR:
+            return 1;
+        case BinaryOp::MAX_BIN_OP:
+            ERROR("Bad binary operator");
+            break;
+    }
+    return 0;
+}
+
+static bool isArithOp(BinaryOp op) { return getPrecedence(op) >= 9; }
+
+static bool isCmpOp(BinaryOp op) {
+    return getPrecedence(op) == 7 || getPrecedence(op) == 6;
+}
+
+static bool isLogicalOp(BinaryOp op) { return getPrecedence(op) <= 2; }
+
+// Checks if the operand of the binary operator can go without parentheses.
+// We omit them only where compilers don't warn about confusing precedence
+// (-Wparentheses), e.g., we keep them for arithmetic inside of shifts and
+// bitwise operators and for && inside of ||.
+static bool canOmitParens(BinaryOp op, const std::shared_ptr<Expr> &operand,
+                          bool is_lhs) {
+    switch (operand->getKind()) {
+        case IRNodeKind::BINARY:
+            break;
+        case IRNodeKind::TERNARY:
+        case IRNodeKind::ASSIGN:
+            return false;
+        default:
+            // Leaves, calls, unary operators and casts bind tighter
+            return true;
+    }
+
+    BinaryOp operand_op = std::static_pointer_cast<BinaryExpr>(operand)->getOp();
+    int prec = getPrecedence(op);
+    int operand_prec = getPrecedence(operand_op);
+    // Operators are left-associative, but chains of comparisons and shifts
+    // look confusing
+    if (operand_prec == prec)
+        return is_lhs && !isCmpOp(op) && op != BinaryOp::SHL &&
+               op != BinaryOp::SHR;
+    if (operand_prec < prec)
+        return false;
+    if (isArithOp(operand_op))
+        return isArithOp(op) || isCmpOp(op) || isLogicalOp(op);
+    if (isCmpOp(operand_op))
+        return isLogicalOp(op);
+    return false;
+}
+
+void BinaryExpr::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                      Indent offset) {
+    bool compact = Options::getInstance().getCompactEmit();
+    stream << offset;
+    if (!compact)
+        stream << "(";
+    emitOperand(ctx, stream, lhs, !compact || !canOmitParens(op, lhs, true));
     switch (op) {
         case BinaryOp::ADD:
             stream << " + ";
@@ -1194,9 +1441,9 @@ void BinaryExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
             ERROR("Bad binary operator");
             break;
     }
-    stream << "(";
-    rhs->emit(ctx, stream);
-    stream << "))";
+    emitOperand(ctx, stream, rhs, !compact || !canOmitParens(op, rhs, false));
+    if (!compact)
+        stream << ")";
 }
 
 BinaryExpr::BinaryExpr(BinaryOp _op, std::shared_ptr<Expr> _lhs,
@@ -1212,7 +1459,76 @@ BinaryExpr::create(std::shared_ptr<PopulateCtx> ctx) {
     BinaryOp op = rand_val_gen->getRandId(gen_pol->binary_op_distr);
     auto lhs = ArithmeticExpr::create(ctx);
     auto rhs = ArithmeticExpr::create(ctx);
-    return std::make_shared<BinaryExpr>(op, lhs, rhs);
+    auto new_node = std::make_shared<BinaryExpr>(op, lhs, rhs);
+    if (Options::getInstance().getUBFreeOps() &&
+        getCurrentValue(new_node->getValue()).hasUB() &&
+        new_node->avoidUB(gen_pol->binary_op_distr))
+        Statistics::getInstance().addAvoidedUB();
+    return new_node;
+}
+
+static OperandConv getOperandConv(BinaryOp op) {
+    switch (op) {
+        case BinaryOp::SHL:
+        case BinaryOp::SHR:
+            return OperandConv::PROMOTION;
+        case BinaryOp::LOG_AND:
+        case BinaryOp::LOG_OR:
+            return OperandConv::TO_BOOL;
+        default:
+            return OperandConv::ARITH_CONV;
+    }
+}
+
+bool BinaryExpr::avoidUB(const std::vector<Probability<BinaryOp>> &distr) {
+    if (op == BinaryOp::SHL || op == BinaryOp::SHR) {
+        // Other operators can't fix the operands of the shift, so we adjust
+        // them in the same way as rebuild does. Random shift amounts are
+        // almost always out of range, so we mask them.
+        auto lhs_int_type =
+            std::static_pointer_cast<IntegralType>(lhs->getValue()->getType());
+        size_t max_sht_val = lhs_int_type->getBitSize() - 1;
+        IRValue rhs_val = getCurrentValue(rhs->getValue());
+        IRValue::AbsValue rhs_abs_val = rhs_val.getAbsValue();
+        if (rhs_abs_val.isNegative || rhs_abs_val.value > max_sht_val) {
+            IRValue mask_val(rhs_val.getIntTypeID());
+            mask_val.setValue(IRValue::AbsValue{false, max_sht_val});
+            rhs = std::make_shared<BinaryExpr>(
+                BinaryOp::BIT_AND, rhs,
+                std::make_shared<ConstantExpr>(mask_val));
+        }
+        if (getCurrentValue(lhs->getValue()).getAbsValue().isNegative)
+            lhs = std::make_shared<BinaryExpr>(
+                BinaryOp::ADD, lhs,
+                std::make_shared<ConstantExpr>(lhs_int_type->getMax()));
+
+        EvalCtx ctx;
+        evaluate(ctx);
+        if (!getCurrentValue(value).hasUB())
+            return true;
+    }
+    return pickUBFreeOp(distr);
+}
+
+bool BinaryExpr::pickUBFreeOp(
+    const std::vector<Probability<BinaryOp>> &distr) {
+    IRValue lhs_val = getCurrentValue(lhs->getValue());
+    IRValue rhs_val = getCurrentValue(rhs->getValue());
+    std::vector<Probability<BinaryOp>> ub_free_ops;
+    for (const auto &prob : distr) {
+        if (prob.getProb() == 0 ||
+            getOperandConv(prob.getId()) != getOperandConv(op))
+            continue;
+        if (!applyBinaryOp(prob.getId(), lhs_val, rhs_val).hasUB())
+            ub_free_ops.push_back(prob);
+    }
+    if (ub_free_ops.empty())
+        return false;
+
+    op = rand_val_gen->getRandId(ub_free_ops);
+    EvalCtx ctx;
+    evaluate(ctx);
+    return true;
 }
 
 TernaryExpr::TernaryExpr(std::shared_ptr<Expr> _cond,
@@ -1263,21 +1579,30 @@ Expr::EvalResType TernaryExpr::evaluate(EvalCtx &ctx) {
 }
 
 Expr::EvalResType TernaryExpr::rebuild(EvalCtx &ctx) {
+    ScopedTraceEvent trace("rebuild", getKind());
     cond->rebuild(ctx);
     true_br->rebuild(ctx);
     false_br->rebuild(ctx);
     return evaluate(ctx);
 }
 
-void TernaryExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                       std::string offset) {
-    stream << offset << "((";
-    cond->emit(ctx, stream);
-    stream << ") ? (";
-    true_br->emit(ctx, stream);
-    stream << ") : (";
-    false_br->emit(ctx, stream);
-    stream << "))";
+void TernaryExpr::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                       Indent offset) {
+    bool compact = Options::getInstance().getCompactEmit();
+    auto need_parens = [compact](const std::shared_ptr<Expr> &operand) {
+        return !compact || operand->getKind() == IRNodeKind::BINARY ||
+               operand->getKind() == IRNodeKind::TERNARY;
+    };
+    stream << offset;
+    if (!compact)
+        stream << "(";
+    emitOperand(ctx, stream, cond, need_parens(cond));
+    stream << " ? ";
+    emitOperand(ctx, stream, true_br, need_parens(true_br));
+    stream << " : ";
+    emitOperand(ctx, stream, false_br, need_parens(false_br));
+    if (!compact)
+        stream << ")";
 }
 
 std::shared_ptr<TernaryExpr>
@@ -1295,33 +1620,26 @@ bool SubscriptExpr::propagateType() {
     return true;
 }
 
-bool SubscriptExpr::inBounds(size_t dim, std::shared_ptr<Data> idx_val,
-                             EvalCtx &ctx) {
+bool SubscriptExpr::inBounds(size_t dim, IRValue idx_val) {
+    idx_int_type_id = idx_val.getIntTypeID();
+    // Absolute value doesn't depend on the type, so we don't need any casts
+    IRValue::AbsValue idx_abs_val = idx_val.getAbsValue();
+    return !idx_abs_val.isNegative && idx_abs_val.value <= dim;
+}
+
+bool SubscriptExpr::inBounds(size_t dim, std::shared_ptr<Data> idx_val) {
     if (idx_val->isScalarVar()) {
         auto scalar_var = std::static_pointer_cast<ScalarVar>(idx_val);
-        IRValue idx_scalar_val = scalar_var->getCurrentValue();
-        idx_int_type_id = idx_scalar_val.getIntTypeID();
-        IRValue zero(idx_scalar_val.getIntTypeID());
-        zero.setValue({false, 0});
-        IRValue size(idx_scalar_val.getIntTypeID());
-        size.setValue({false, dim});
-
         assert(scalar_var->getType()->isIntType() &&
                "Scalar variable can have only integral type for now");
-        auto int_type =
-            std::static_pointer_cast<IntegralType>(scalar_var->getType());
-        IntTypeID max_type_id =
-            int_type->getIsSigned() ? IntTypeID::LLONG : IntTypeID::ULLONG;
-        idx_scalar_val = idx_scalar_val.castToType(max_type_id);
-        zero = zero.castToType(max_type_id);
-        size = size.castToType(max_type_id);
-        return (zero <= idx_scalar_val).getValueRef<bool>() &&
-               (idx_scalar_val <= size).getValueRef<bool>();
+        return inBounds(dim, scalar_var->getCurrentValue());
     }
     else if (idx_val->isIterator()) {
+        // Iterators keep the values of their parameters, so we don't need to
+        // evaluate them
         auto iter_var = std::static_pointer_cast<Iterator>(idx_val);
-        return inBounds(dim, iter_var->getStart()->evaluate(ctx), ctx) &&
-               inBounds(dim, iter_var->getEnd()->evaluate(ctx), ctx);
+        return inBounds(dim, iter_var->getStartValue()) &&
+               inBounds(dim, iter_var->getEndValue());
     }
     else {
         ERROR("We can use only Scalar Variables or Iterator as index");
@@ -1332,7 +1650,6 @@ bool SubscriptExpr::inBounds(size_t dim, std::shared_ptr<Data> idx_val,
 Expr::EvalResType SubscriptExpr::evaluate(EvalCtx &ctx) {
     propagateType();
 
-    auto emit_ctx = std::make_shared<EmitCtx>();
     EvalResType array_eval_res = array->evaluate(ctx);
     if (!array_eval_res->getType()->isArrayType()) {
         ERROR("Subscription operation is supported only for Array");
@@ -1354,7 +1671,7 @@ Expr::EvalResType SubscriptExpr::evaluate(EvalCtx &ctx) {
     UBKind ub_code = UBKind::NoUB;
 
     EvalResType idx_eval_res = idx->evaluate(ctx);
-    if (!inBounds(active_size, idx_eval_res, ctx))
+    if (!inBounds(active_size, idx_eval_res))
         ub_code = UBKind::OutOfBounds;
 
     if (active_dim < array_type->getDimensions().size() - 1)
@@ -1378,6 +1695,7 @@ Expr::EvalResType SubscriptExpr::evaluate(EvalCtx &ctx) {
 }
 
 Expr::EvalResType SubscriptExpr::rebuild(EvalCtx &ctx) {
+    ScopedTraceEvent trace("rebuild", getKind());
     propagateType();
     idx->rebuild(ctx);
     array->rebuild(ctx);
@@ -1387,20 +1705,24 @@ Expr::EvalResType SubscriptExpr::rebuild(EvalCtx &ctx) {
 
     assert(eval_res->getUBCode() == UBKind::OutOfBounds &&
            "Every other UB should be handled before");
+    Statistics &stats = Statistics::getInstance();
+    stats.addUB(eval_res->getUBCode());
+    stats.addSubscriptRewrite();
 
     IRValue active_size_val(idx_int_type_id);
     active_size_val.setValue({false, active_size});
     auto size_constant = std::make_shared<ConstantExpr>(active_size_val);
     idx = std::make_shared<BinaryExpr>(BinaryOp::MOD, idx, size_constant);
 
+    stats.addReevaluation();
     eval_res = evaluate(ctx);
-    assert(eval_res->hasUB() && "All of the UB should be fixed by now");
+    assert(!eval_res->hasUB() && "All of the UB should be fixed by now");
     value = eval_res;
     return eval_res;
 }
 
-void SubscriptExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                         std::string offset) {
+void SubscriptExpr::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                         Indent offset) {
     stream << offset;
     // TODO: it may cause some problems in the future
     array->emit(ctx, stream);
@@ -1486,8 +1808,13 @@ SubscriptExpr::init(std::shared_ptr<Array> arr,
                ctx->getLocalSymTable()->getIters().size() &&
            "We can create a SubscriptExpr only if we have enough iterators");
     for (size_t i = 0; i < array_type->getDimensions().size(); ++i) {
-        auto iter = rand_val_gen->getRandElem(
-            ctx->getLocalSymTable()->getIters().at(i));
+        // We pick only iterators that fit the dimension, so the index doesn't
+        // need a rewrite later
+        auto iters = ctx->getLocalSymTable()->getItersInRange(
+            i, array_type->getDimensions().at(i));
+        if (iters.empty())
+            iters = ctx->getLocalSymTable()->getIters().at(i);
+        auto iter = rand_val_gen->getRandElem(iters);
         auto iter_use_expr = std::make_shared<IterUseExpr>(iter);
         res_expr = std::make_shared<SubscriptExpr>(res_expr, iter_use_expr);
     }
@@ -1497,8 +1824,14 @@ SubscriptExpr::init(std::shared_ptr<Array> arr,
 bool AssignmentExpr::propagateType() {
     to->propagateType();
     from->propagateType();
-    from =
-        std::make_shared<TypeCastExpr>(from, to->getValue()->getType(), true);
+    // Types are interned, so we can cheaply check if the conversion is
+    // already in place and avoid stacking the same implicit casts.
+    auto to_type = to->getValue()->getType();
+    if (from->getKind() == IRNodeKind::TYPE_CAST &&
+        from->getValue()->getType() == to_type &&
+        std::static_pointer_cast<TypeCastExpr>(from)->getIsImplicit())
+        return true;
+    from = std::make_shared<TypeCastExpr>(from, to_type, true);
     return true;
 }
 
@@ -1543,14 +1876,15 @@ Expr::EvalResType AssignmentExpr::evaluate(EvalCtx &ctx) {
 }
 
 Expr::EvalResType AssignmentExpr::rebuild(EvalCtx &ctx) {
+    ScopedTraceEvent trace("rebuild", getKind());
     propagateType();
     to->rebuild(ctx);
     from->rebuild(ctx);
     return evaluate(ctx);
 }
 
-void AssignmentExpr::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                          std::string offset) {
+void AssignmentExpr::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                          Indent offset) {
     stream << offset;
     to->emit(ctx, stream);
     stream << " = ";
@@ -1593,7 +1927,15 @@ AssignmentExpr::create(std::shared_ptr<PopulateCtx> ctx) {
         to->getValue()->getType()->isUniform())
         from = std::make_shared<ExtractCall>(from);
 
-    return std::make_shared<AssignmentExpr>(to, from, ctx->isTaken());
+    Statistics &stats = Statistics::getInstance();
+    uint64_t to_cost = getNodeCost(ctx, to->getKind());
+    stats.addExpr(to_cost);
+    to->setComplexity(to_cost);
+
+    auto new_assign =
+        std::make_shared<AssignmentExpr>(to, from, ctx->isTaken());
+    new_assign->setComplexity(from->getComplexity() + to_cost);
+    return new_assign;
 }
 
 std::shared_ptr<LibCallExpr>
@@ -1748,8 +2090,8 @@ Expr::EvalResType MinMaxCallBase::evaluate(yarpgen::EvalCtx &ctx) {
     return value;
 }
 
-void MinMaxCallBase::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                          std::string offset) {
+void MinMaxCallBase::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                          Indent offset) {
     Options &options = Options::getInstance();
     stream << offset;
     if (options.isCXX())
@@ -1760,11 +2102,13 @@ void MinMaxCallBase::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
         stream << "min";
     else
         ERROR("Unsupported LibCallKind");
-    stream << "((";
-    a->emit(ctx, stream);
-    stream << "), (";
-    b->emit(ctx, stream);
-    stream << "))";
+    // Arguments can't contain commas, so they never need parentheses
+    bool parens = !options.getCompactEmit();
+    stream << "(";
+    emitOperand(ctx, stream, a, parens);
+    stream << ", ";
+    emitOperand(ctx, stream, b, parens);
+    stream << ")";
 }
 
 std::shared_ptr<LibCallExpr>
@@ -1814,8 +2158,8 @@ MinMaxCallBase::createHelper(std::shared_ptr<PopulateCtx> ctx,
 }
 
 void MinMaxCallBase::emitCDefinitionImpl(std::shared_ptr<EmitCtx> ctx,
-                                         std::ostream &stream,
-                                         std::string offset, LibCallKind kind) {
+                                         SourceWriter &stream,
+                                         Indent offset, LibCallKind kind) {
     std::string func_name, func_sign;
     if (kind == LibCallKind::MAX) {
         func_name = "max";
@@ -1894,21 +2238,23 @@ Expr::EvalResType SelectCall::evaluate(EvalCtx &ctx) {
 }
 
 Expr::EvalResType SelectCall::rebuild(EvalCtx &ctx) {
+    ScopedTraceEvent trace("rebuild", getKind());
     cond->rebuild(ctx);
     true_arg->rebuild(ctx);
     false_arg->rebuild(ctx);
     return evaluate(ctx);
 }
 
-void SelectCall::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                      std::string offset) {
-    stream << offset << "select((";
-    cond->emit(ctx, stream);
-    stream << "), (";
-    true_arg->emit(ctx, stream);
-    stream << "), (";
-    false_arg->emit(ctx, stream);
-    stream << "))";
+void SelectCall::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                      Indent offset) {
+    bool parens = !Options::getInstance().getCompactEmit();
+    stream << offset << "select(";
+    emitOperand(ctx, stream, cond, parens);
+    stream << ", ";
+    emitOperand(ctx, stream, true_arg, parens);
+    stream << ", ";
+    emitOperand(ctx, stream, false_arg, parens);
+    stream << ")";
 }
 
 std::shared_ptr<LibCallExpr>
@@ -1958,7 +2304,7 @@ Expr::EvalResType LogicalReductionBase::evaluate(EvalCtx &ctx) {
 }
 
 void LogicalReductionBase::emit(std::shared_ptr<EmitCtx> ctx,
-                                std::ostream &stream, std::string offset) {
+                                SourceWriter &stream, Indent offset) {
     stream << offset;
     if (kind == LibCallKind::ANY)
         stream << "any";
@@ -1968,9 +2314,9 @@ void LogicalReductionBase::emit(std::shared_ptr<EmitCtx> ctx,
         stream << "none";
     else
         ERROR("Unsupported LibCallKind");
-    stream << "((";
-    arg->emit(ctx, stream);
-    stream << "))";
+    stream << "(";
+    emitOperand(ctx, stream, arg, !Options::getInstance().getCompactEmit());
+    stream << ")";
 }
 
 std::shared_ptr<LibCallExpr>
@@ -2030,7 +2376,7 @@ Expr::EvalResType MinMaxEqReductionBase::evaluate(EvalCtx &ctx) {
 }
 
 void MinMaxEqReductionBase::emit(std::shared_ptr<EmitCtx> ctx,
-                                 std::ostream &stream, std::string offset) {
+                                 SourceWriter &stream, Indent offset) {
     stream << offset;
     if (kind == LibCallKind::RED_MIN)
         stream << "reduce_min";
@@ -2040,9 +2386,9 @@ void MinMaxEqReductionBase::emit(std::shared_ptr<EmitCtx> ctx,
         stream << "reduce_equal";
     else
         ERROR("Unsupported LibCallKind");
-    stream << "((";
-    arg->emit(ctx, stream);
-    stream << "))";
+    stream << "(";
+    emitOperand(ctx, stream, arg, !Options::getInstance().getCompactEmit());
+    stream << ")";
 }
 
 std::shared_ptr<LibCallExpr>
@@ -2088,14 +2434,14 @@ Expr::EvalResType ExtractCall::evaluate(EvalCtx &ctx) {
     return value;
 }
 
-void ExtractCall::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                       std::string offset) {
-    stream << offset << "extract";
-    stream << "((";
-    arg->emit(ctx, stream);
-    stream << "), (";
-    idx->emit(ctx, stream);
-    stream << "))";
+void ExtractCall::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                       Indent offset) {
+    bool parens = !Options::getInstance().getCompactEmit();
+    stream << offset << "extract(";
+    emitOperand(ctx, stream, arg, parens);
+    stream << ", ";
+    emitOperand(ctx, stream, idx, parens);
+    stream << ")";
 }
 
 std::shared_ptr<LibCallExpr>
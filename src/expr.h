@@ -26,6 +26,7 @@ limitations under the License.
 #include "data.h"
 #include "ir_node.h"
 #include "ir_value.h"
+#include "trace.h"
 
 namespace yarpgen {
 
@@ -35,8 +36,9 @@ class PopulateCtx;
 // Common ancestor for all classes that represent various expressions
 class Expr : public IRNode {
   public:
-    explicit Expr(std::shared_ptr<Data> _value) : value(std::move(_value)) {}
-    Expr() = default;
+    explicit Expr(std::shared_ptr<Data> _value)
+        : value(std::move(_value)), complexity(0) {}
+    Expr() : complexity(0) {}
 
     // This type represent result of computation. We keep it simple for now,
     // but it might change in the future.
@@ -60,23 +62,21 @@ class Expr : public IRNode {
     virtual IRNodeKind getKind() { return IRNodeKind::MAX_EXPR_KIND; }
     virtual std::shared_ptr<Data> getValue();
 
+    // Estimated compile cost of the subtree (see Statistics for the model).
+    // It is set when the node is created.
+    uint64_t getComplexity() { return complexity; }
+    void setComplexity(uint64_t val) { complexity = val; }
+
   protected:
     std::shared_ptr<Data> value;
 
   private:
-    // TODO: add complexity tracker
-    /*
-    uint32_t complexity;
-
-    // Count of expression over all test program
-    static uint32_t total_expr_count;
-    // Count of expression per single test function
-    static uint32_t func_expr_count;
-    */
+    uint64_t complexity;
 };
 
 // Constant representation
-class ConstantExpr : public Expr {
+class ConstantExpr : public Expr,
+                     private MemTracked<ConstantExpr, MemKind::CONST_EXPR> {
   public:
     explicit ConstantExpr(IRValue _value);
     IRNodeKind getKind() final { return IRNodeKind::CONST; }
@@ -85,8 +85,8 @@ class ConstantExpr : public Expr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
     static std::shared_ptr<ConstantExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
 
@@ -102,7 +102,9 @@ class VarUseExpr : public Expr {
     void setIsDead(bool val) { value->setIsDead(val); }
 };
 
-class ScalarVarUseExpr : public VarUseExpr {
+class ScalarVarUseExpr
+    : public VarUseExpr,
+      private MemTracked<ScalarVarUseExpr, MemKind::SCALAR_VAR_USE_EXPR> {
   public:
     // No one is supposed to call this constructor directly.
     // It is left public in order to use std::make_shared
@@ -117,8 +119,8 @@ class ScalarVarUseExpr : public VarUseExpr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final {
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final {
         stream << offset << value->getName(ctx);
     };
     static std::shared_ptr<ScalarVarUseExpr>
@@ -130,7 +132,8 @@ class ScalarVarUseExpr : public VarUseExpr {
         scalar_var_use_set;
 };
 
-class ArrayUseExpr : public VarUseExpr {
+class ArrayUseExpr : public VarUseExpr,
+                     private MemTracked<ArrayUseExpr, MemKind::ARRAY_USE_EXPR> {
   public:
     explicit ArrayUseExpr(std::shared_ptr<Data> _val)
         : VarUseExpr(std::move(_val)) {}
@@ -143,8 +146,8 @@ class ArrayUseExpr : public VarUseExpr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final {
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final {
         stream << offset << value->getName(ctx);
     };
 
@@ -154,7 +157,8 @@ class ArrayUseExpr : public VarUseExpr {
         array_use_set;
 };
 
-class IterUseExpr : public VarUseExpr {
+class IterUseExpr : public VarUseExpr,
+                    private MemTracked<IterUseExpr, MemKind::ITER_USE_EXPR> {
   public:
     explicit IterUseExpr(std::shared_ptr<Data> _val)
         : VarUseExpr(std::move(_val)) {}
@@ -167,8 +171,8 @@ class IterUseExpr : public VarUseExpr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final {
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final {
         stream << offset << value->getName(ctx);
     };
 
@@ -178,7 +182,8 @@ class IterUseExpr : public VarUseExpr {
         iter_use_set;
 };
 
-class TypeCastExpr : public Expr {
+class TypeCastExpr : public Expr,
+                     private MemTracked<TypeCastExpr, MemKind::TYPE_CAST_EXPR> {
   public:
     TypeCastExpr(std::shared_ptr<Expr> _expr, std::shared_ptr<Type> _to_type,
                  bool _is_implicit);
@@ -189,11 +194,13 @@ class TypeCastExpr : public Expr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
     static std::shared_ptr<TypeCastExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
 
+    bool getIsImplicit() { return is_implicit; }
+
   private:
     std::shared_ptr<Expr> expr;
     std::shared_ptr<Type> to_type;
@@ -217,7 +224,8 @@ class ArithmeticExpr : public Expr {
                                  std::shared_ptr<Expr> &rhs);
 };
 
-class UnaryExpr : public ArithmeticExpr {
+class UnaryExpr : public ArithmeticExpr,
+                  private MemTracked<UnaryExpr, MemKind::UNARY_EXPR> {
   public:
     UnaryExpr(UnaryOp _op, std::shared_ptr<Expr> _expr);
     IRNodeKind getKind() final { return IRNodeKind::UNARY; }
@@ -226,16 +234,22 @@ class UnaryExpr : public ArithmeticExpr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
     static std::shared_ptr<UnaryExpr> create(std::shared_ptr<PopulateCtx> ctx);
 
   private:
+    // Replaces the operator with a random one from the distribution that
+    // converts the operand in the same way and doesn't cause UB for its
+    // current value. Returns false if there is no such operator.
+    bool pickUBFreeOp(const std::vector<Probability<UnaryOp>> &distr);
+
     UnaryOp op;
     std::shared_ptr<Expr> arg;
 };
 
-class BinaryExpr : public ArithmeticExpr {
+class BinaryExpr : public ArithmeticExpr,
+                   private MemTracked<BinaryExpr, MemKind::BINARY_EXPR> {
   public:
     BinaryExpr(BinaryOp _op, std::shared_ptr<Expr> _lhs,
                std::shared_ptr<Expr> _rhs);
@@ -245,17 +259,28 @@ class BinaryExpr : public ArithmeticExpr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
     static std::shared_ptr<BinaryExpr> create(std::shared_ptr<PopulateCtx> ctx);
 
+    BinaryOp getOp() { return op; }
+
   private:
+    // Tries to eliminate UB of the new node. Operands of the shifts are
+    // adjusted, other operators are replaced with pickUBFreeOp.
+    bool avoidUB(const std::vector<Probability<BinaryOp>> &distr);
+    // Same as UnaryExpr::pickUBFreeOp. Arithmetic, comparison and bitwise
+    // operators share the conversions, so we can replace, for example, an
+    // overflowing ADD with SUB or with a comparison.
+    bool pickUBFreeOp(const std::vector<Probability<BinaryOp>> &distr);
+
     BinaryOp op;
     std::shared_ptr<Expr> lhs;
     std::shared_ptr<Expr> rhs;
 };
 
-class TernaryExpr : public ArithmeticExpr {
+class TernaryExpr : public ArithmeticExpr,
+                    private MemTracked<TernaryExpr, MemKind::TERNARY_EXPR> {
   public:
     TernaryExpr(std::shared_ptr<Expr> _cond, std::shared_ptr<Expr> _true_br,
                 std::shared_ptr<Expr> _false_br);
@@ -265,8 +290,8 @@ class TernaryExpr : public ArithmeticExpr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
     static std::shared_ptr<TernaryExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
 
@@ -276,7 +301,9 @@ class TernaryExpr : public ArithmeticExpr {
     std::shared_ptr<Expr> false_br;
 };
 
-class SubscriptExpr : public Expr {
+class SubscriptExpr
+    : public Expr,
+      private MemTracked<SubscriptExpr, MemKind::SUBSCRIPT_EXPR> {
   public:
     SubscriptExpr(std::shared_ptr<Expr> _arr, std::shared_ptr<Expr> _idx);
     IRNodeKind getKind() final { return IRNodeKind::SUBSCRIPT; }
@@ -287,8 +314,8 @@ class SubscriptExpr : public Expr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
     static std::shared_ptr<SubscriptExpr>
     init(std::shared_ptr<Array> arr, std::shared_ptr<PopulateCtx> ctx);
     static std::shared_ptr<SubscriptExpr>
@@ -298,7 +325,8 @@ class SubscriptExpr : public Expr {
     void setIsDead(bool val);
 
   private:
-    bool inBounds(size_t dim, std::shared_ptr<Data> idx_val, EvalCtx &ctx);
+    bool inBounds(size_t dim, std::shared_ptr<Data> idx_val);
+    bool inBounds(size_t dim, IRValue idx_val);
 
     std::shared_ptr<Expr> array;
     std::shared_ptr<Expr> idx;
@@ -308,7 +336,9 @@ class SubscriptExpr : public Expr {
     IntTypeID idx_int_type_id;
 };
 
-class AssignmentExpr : public Expr {
+class AssignmentExpr
+    : public Expr,
+      private MemTracked<AssignmentExpr, MemKind::ASSIGN_EXPR> {
   public:
     AssignmentExpr(std::shared_ptr<Expr> _to, std::shared_ptr<Expr> _from,
                    bool _taken = true)
@@ -319,8 +349,8 @@ class AssignmentExpr : public Expr {
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
     static std::shared_ptr<AssignmentExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
 
@@ -337,7 +367,8 @@ class CallExpr : public Expr {
   private:
 };
 
-class LibCallExpr : public CallExpr {
+class LibCallExpr : public CallExpr,
+                    private MemTracked<LibCallExpr, MemKind::CALL_EXPR> {
   public:
     static std::shared_ptr<LibCallExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
@@ -361,12 +392,13 @@ class MinMaxCallBase : public LibCallExpr {
     bool propagateType() final;
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final {
+        ScopedTraceEvent trace("rebuild", getKind());
         a->rebuild(ctx);
         b->rebuild(ctx);
         return evaluate(ctx);
     }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") override;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) override;
 
   protected:
     MinMaxCallBase(std::shared_ptr<Expr> _a, std::shared_ptr<Expr> _b,
@@ -374,7 +406,7 @@ class MinMaxCallBase : public LibCallExpr {
     static std::shared_ptr<LibCallExpr>
     createHelper(std::shared_ptr<PopulateCtx> ctx, LibCallKind kind);
     static void emitCDefinitionImpl(std::shared_ptr<EmitCtx> ctx,
-                                    std::ostream &stream, std::string offset,
+                                    SourceWriter &stream, Indent offset,
                                     LibCallKind kind);
     std::shared_ptr<Expr> a;
     std::shared_ptr<Expr> b;
@@ -390,7 +422,8 @@ class MinCall : public MinMaxCallBase {
         return createHelper(std::move(ctx), LibCallKind::MIN);
     }
     static void emitCDefinition(std::shared_ptr<EmitCtx> ctx,
-                                std::ostream &stream, std::string offset = "") {
+                                SourceWriter &stream,
+                                Indent offset = Indent()) {
         emitCDefinitionImpl(ctx, stream, offset, LibCallKind::MAX);
     }
 };
@@ -404,7 +437,8 @@ class MaxCall : public MinMaxCallBase {
         return createHelper(std::move(ctx), LibCallKind::MAX);
     }
     static void emitCDefinition(std::shared_ptr<EmitCtx> ctx,
-                                std::ostream &stream, std::string offset = "") {
+                                SourceWriter &stream,
+                                Indent offset = Indent()) {
         emitCDefinitionImpl(ctx, stream, offset, LibCallKind::MIN);
     }
 };
@@ -416,8 +450,8 @@ class SelectCall : public LibCallExpr {
     bool propagateType() final;
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final;
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
     static std::shared_ptr<LibCallExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
 
@@ -432,11 +466,12 @@ class LogicalReductionBase : public LibCallExpr {
     bool propagateType() final;
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final {
+        ScopedTraceEvent trace("rebuild", getKind());
         arg->rebuild(ctx);
         return evaluate(ctx);
     }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
 
   protected:
     LogicalReductionBase(std::shared_ptr<Expr> _arg, LibCallKind _kind);
@@ -484,11 +519,12 @@ class MinMaxEqReductionBase : public LibCallExpr {
     bool propagateType() final;
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final {
+        ScopedTraceEvent trace("rebuild", getKind());
         arg->rebuild(ctx);
         return evaluate(ctx);
     }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
 
   protected:
     MinMaxEqReductionBase(std::shared_ptr<Expr> _arg, LibCallKind _kind);
@@ -538,11 +574,12 @@ class ExtractCall : public LibCallExpr {
     bool propagateType() final;
     EvalResType evaluate(EvalCtx &ctx) final;
     EvalResType rebuild(EvalCtx &ctx) final {
+        ScopedTraceEvent trace("rebuild", getKind());
         arg->rebuild(ctx);
         return evaluate(ctx);
     };
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
     static std::shared_ptr<LibCallExpr>
     create(std::shared_ptr<PopulateCtx> ctx);
 
@@ -33,7 +33,7 @@ static void shuffleProbProxy(std::vector<Probability<T>> &vec) {
 GenPolicy::GenPolicy() {
     Options &options = Options::getInstance();
 
-    stmt_num_lim = 1000;
+    stmt_num_lim = options.getStmtNumLim();
 
     loop_seq_num_lim = 4;
     uniformProbFromMax(loop_seq_num_distr, loop_seq_num_lim, 1);
@@ -101,7 +101,7 @@ GenPolicy::GenPolicy() {
     out_kind_distr.emplace_back(Probability<DataKind>(DataKind::ARR, 20));
     shuffleProbProxy(out_kind_distr);
 
-    max_arith_depth = 3;
+    max_arith_depth = options.getMaxArithDepth();
 
     arith_node_distr.emplace_back(
         Probability<IRNodeKind>(IRNodeKind::CONST, 10));
@@ -27,7 +27,9 @@ class GenPolicy {
   public:
     GenPolicy();
 
-    // Hard limit for total statements number
+    // Hard limit for total statements number. It changes only the width of
+    // the test: statements of a block are generated, populated and emitted
+    // in a loop, so it doesn't affect the depth of the recursion.
     size_t stmt_num_lim;
 
     // Maximal number of loops in a single LoopSequence
@@ -46,6 +48,9 @@ class GenPolicy {
     // Hard threshold for if-else dpeth
     size_t if_else_depth_limit;
 
+    // Recursion of generateStructure(), populate() and emit() for statements
+    // follows the nesting of the test, so these two limits bound it.
+
     // Number of statements in a scope
     size_t scope_stmt_min_num;
     size_t scope_stmt_max_num;
@@ -89,7 +94,11 @@ class GenPolicy {
     // Output kind probability
     std::vector<Probability<DataKind>> out_kind_distr;
 
-    // Maximal depth of arithmetic expression
+    // Maximal depth of arithmetic expression. It bounds the recursion of
+    // create(), rebuild() and emit() for expressions (implicit casts add a
+    // few levels). --max-arith-depth doesn't accept values above 16, so
+    // the recursion stays shallow. The size of a tree grows exponentially
+    // with the depth, so the generation time runs out long before that.
     size_t max_arith_depth;
     // Distribution of nodes in arithmetic expression
     std::vector<Probability<IRNodeKind>> arith_node_distr;
@@ -30,7 +30,9 @@ int main() {
     auto gen_ctx = std::make_shared<GenCtx>();
     auto scope_stmt = ScopeStmt::generateStructure(gen_ctx);
     auto emit_ctx = std::make_shared<EmitCtx>();
-    scope_stmt->emit(emit_ctx, std::cout);
+    SourceWriter stream;
+    scope_stmt->emit(emit_ctx, stream);
+    stream.writeTo(std::cout);
     std::cout << std::endl;
     return 0;
 }
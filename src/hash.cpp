@@ -56,54 +56,31 @@ std::size_t IntTypeKeyHasher::operator()(const IntTypeKey &key) const {
     return hash.getSeed();
 }
 
-ArrayTypeKey::ArrayTypeKey(std::shared_ptr<Type> _base_type,
-                           std::vector<size_t> _dims, ArrayKind _kind,
-                           bool _is_static, CVQualifier _cv_qual,
-                           bool _is_uniform)
-    : base_type(std::move(_base_type)), dims(std::move(_dims)), kind(_kind),
-      is_static(_is_static), cv_qualifier(_cv_qual), is_uniform(_is_uniform) {}
-
-bool ArrayTypeKey::operator==(const ArrayTypeKey &other) const {
-    if (base_type != other.base_type)
-        return false;
-
-    if (base_type->isIntType()) {
-        auto base_int_type = std::static_pointer_cast<IntegralType>(base_type);
-        auto other_int_type =
-            std::static_pointer_cast<IntegralType>(other.base_type);
-        if (!IntegralType::isSame(base_int_type, other_int_type)) {
-            return false;
-        }
-    }
-    else {
+ArrayTypeKey::ArrayTypeKey(Type *_base_type, const std::vector<size_t> &_dims,
+                           ArrayKind _kind, bool _is_static,
+                           CVQualifier _cv_qual, bool _is_uniform)
+    : base_type(_base_type), dims(&_dims), kind(_kind), is_static(_is_static),
+      cv_qualifier(_cv_qual), is_uniform(_is_uniform) {
+    if (!base_type->isIntType())
         ERROR("Unsupported base type for array!");
-    }
 
-    return (dims == other.dims) && (kind == other.kind) &&
-           (is_static == other.is_static) &&
+    Hash hasher;
+    hasher(reinterpret_cast<uintptr_t>(base_type));
+    hasher(*dims);
+    hasher(kind);
+    hasher(is_static);
+    hasher(cv_qualifier);
+    hasher(is_uniform);
+    hash = hasher.getSeed();
+}
+
+bool ArrayTypeKey::operator==(const ArrayTypeKey &other) const {
+    return (hash == other.hash) && (base_type == other.base_type) &&
+           (kind == other.kind) && (is_static == other.is_static) &&
            (cv_qualifier == other.cv_qualifier) &&
-           (is_uniform == other.is_uniform);
+           (is_uniform == other.is_uniform) && (*dims == *other.dims);
 }
 
 std::size_t ArrayTypeKeyHasher::operator()(const ArrayTypeKey &key) const {
-    Hash hash;
-
-    if (key.base_type->isIntType()) {
-        auto base_int_type =
-            std::static_pointer_cast<IntegralType>(key.base_type);
-        IntTypeKeyHasher base_int_hasher;
-        size_t base_int_hash = base_int_hasher(IntTypeKey(base_int_type));
-        hash(base_int_hash);
-    }
-    else {
-        ERROR("Unsupported base type for array");
-    }
-
-    hash(key.dims);
-    hash(key.kind);
-    hash(key.is_static);
-    hash(key.cv_qualifier);
-    hash(key.is_uniform);
-
-    return hash.getSeed();
+    return key.hash;
 }
@@ -19,6 +19,7 @@ limitations under the License.
 
 #pragma once
 
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <vector>
@@ -35,7 +36,6 @@ class Hash {
   public:
     Hash() : seed(HASH_SEED) {}
 
-    // TODO: we have a collisions. We need to think about better hash-functions
     template <typename T>
     inline typename std::enable_if<std::is_fundamental<T>::value, void>::type
     operator()(T value) {
@@ -57,7 +57,7 @@ class Hash {
             std::hash<enum_under_type>()(static_cast<enum_under_type>(value)));
     }
 
-    template <typename T> inline void operator()(std::vector<T> value) {
+    template <typename T> inline void operator()(const std::vector<T> &value) {
         Hash hash;
         for (const auto &elem : value)
             hash(elem);
@@ -66,10 +66,40 @@ class Hash {
 
     size_t getSeed() { return seed; }
 
+    // FNV-1a hash of a byte sequence. Unlike the hash above, it doesn't depend
+    // on the implementation of std::hash, so it can be stored in files and
+    // checked by other tools.
+    static uint64_t hashBytes(const char *data, size_t size,
+                              uint64_t hash = FNV_OFFSET_BASIS) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    static const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325ULL;
+    static const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
   private:
-    // Combine existing seed with a new hash value.
+    // Combine existing seed with a new hash value. std::hash is an identity
+    // function for integers in most of the implementations, so we need to
+    // scramble both of the values. Otherwise small keys (e.g. array
+    // dimensions) tend to collide.
     void hashCombine(size_t value) {
-        seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        seed = static_cast<size_t>(
+            mix(static_cast<uint64_t>(seed) ^
+                mix(static_cast<uint64_t>(value) + 0x9e3779b97f4a7c15ULL)));
+    }
+
+    // SplitMix64 finalizer
+    static uint64_t mix(uint64_t value) {
+        value ^= value >> 30;
+        value *= 0xbf58476d1ce4e5b9ULL;
+        value ^= value >> 27;
+        value *= 0x94d049bb133111ebULL;
+        value ^= value >> 31;
+        return value;
     }
 
     size_t seed;
@@ -102,19 +132,25 @@ class IntTypeKeyHasher {
 class Type;
 
 // This class is used as a key in the folding set.
+// All of the base types are interned, so we can identify them by the pointer.
+// The key doesn't own the dimensions. The key that is used for the lookup
+// points to the dimensions that were passed by the caller, while the key
+// that is stored in the folding set points to the dimensions of the interned
+// type itself. This way we never copy them. The hash is computed only once.
 class ArrayTypeKey {
   public:
-    ArrayTypeKey(std::shared_ptr<Type> _base_type, std::vector<size_t> _dims,
+    ArrayTypeKey(Type *_base_type, const std::vector<size_t> &_dims,
                  ArrayKind _kind, bool _is_static, CVQualifier _cv_qual,
                  bool _is_uniform);
     bool operator==(const ArrayTypeKey &other) const;
 
-    std::shared_ptr<Type> base_type;
-    std::vector<size_t> dims;
+    Type *base_type;
+    const std::vector<size_t> *dims;
     ArrayKind kind;
     bool is_static;
     CVQualifier cv_qualifier;
     bool is_uniform;
+    size_t hash;
 };
 
 // This class provides a hashing mechanism for folding set.
@@ -19,6 +19,8 @@ limitations under the License.
 
 #pragma once
 
+#include "source_writer.h"
+
 #include <iostream>
 
 namespace yarpgen {
@@ -34,8 +36,8 @@ class IRNode {
     // offset properly.
     // TODO: in the future we might output the same test using different
     // language constructions
-    virtual void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                      std::string offset = "") = 0;
+    virtual void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                      Indent offset = Indent()) = 0;
     // TODO: make it pure virtual later
     virtual void populate(std::shared_ptr<PopulateCtx> ctx){};
 };
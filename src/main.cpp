@@ -18,6 +18,8 @@ limitations under the License.
 //////////////////////////////////////////////////////////////////////////////
 #include "options.h"
 #include "program.h"
+#include "statistics.h"
+#include "trace.h"
 #include "utils.h"
 
 #include <iostream>
@@ -34,8 +36,30 @@ int main(int argc, char *argv[]) {
     rand_val_gen = std::make_shared<RandValGen>(options.getSeed());
     options.setSeed(rand_val_gen->getSeed());
 
-    ProgramGenerator new_program;
-    new_program.emit();
+    Statistics &stats = Statistics::getInstance();
+    if (options.useStatsJson())
+        stats.enableTimers();
+    if (options.getMemReport())
+        stats.enableMemTracking();
+    if (options.useTrace())
+        Tracer::getInstance().enable();
+    if (options.useDeadline())
+        stats.setDeadline(options.getDeadlineMs());
+    if (options.useMemBudget())
+        stats.setMemBudget(options.getMemBudget() * 1024);
+
+    {
+        ScopedTimer timer(GenPhase::TOTAL);
+        ProgramGenerator new_program;
+        new_program.emit();
+    }
+
+    if (options.getMemReport())
+        stats.writeMemReport(std::cerr);
+    if (options.useStatsJson())
+        stats.writeJson(options.getStatsJson(), options.getSeed());
+    if (options.useTrace())
+        Tracer::getInstance().writeJson(options.getTrace());
 
     return 0;
 }
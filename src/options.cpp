@@ -18,6 +18,7 @@ limitations under the License.
 //////////////////////////////////////////////////////////////////////////////
 
 #include "options.h"
+#include "hash.h"
 #include "utils.h"
 #include <cstring>
 #include <functional>
@@ -47,6 +48,11 @@ using namespace yarpgen;
 
 static const size_t PADDING = 30;
 
+// Upper bound for --max-arith-depth. Creation, rebuild and emission of the
+// expressions are recursive, so the depth of the trees bounds the depth of
+// the stack (see GenPolicy::max_arith_depth).
+static const size_t MAX_ARITH_DEPTH_LIMIT = 16;
+
 // Short argument, long argument, has_value, help message, error message,
 // action function, default, possible values
 std::vector<OptionDescr> yarpgen::OptionParser::options_set{
@@ -176,6 +182,185 @@ std::vector<OptionDescr> yarpgen::OptionParser::options_set{
      OptionParser::parseExplLoopParams,
      "false",
      {"true", "false"}},
+    {OptionKind::EMIT_THREADS,
+     "",
+     "--emit-threads",
+     true,
+     "Number of threads for the emission of the test files",
+     "Can't parse number of emission threads",
+     OptionParser::parseEmitThreads,
+     "1",
+     {}},
+    {OptionKind::FUNC_NUM,
+     "",
+     "--func-num",
+     true,
+     "Number of test functions (each one goes to a separate file)",
+     "Can't parse number of test functions",
+     OptionParser::parseFuncNum,
+     "1",
+     {}},
+    {OptionKind::ARCHIVE,
+     "",
+     "--archive",
+     true,
+     "Append the test to the archive file (and its .idx index) instead of "
+     "writing separate files to the output folder",
+     "Can't parse archive file name",
+     OptionParser::parseArchive,
+     "",
+     {}},
+    {OptionKind::CHECKSUM_MODE,
+     "",
+     "--checksum-mode",
+     true,
+     "Hash output arrays element by element or as a whole",
+     "Can't parse checksum mode",
+     OptionParser::parseChecksumMode,
+     "elem",
+     {"elem", "bulk"}},
+    {OptionKind::ARRAY_INIT,
+     "",
+     "--array-init",
+     true,
+     "Initialize arrays with loops or with the cheapest appropriate means",
+     "Can't parse array initialization mode",
+     OptionParser::parseArrayInit,
+     "loop",
+     {"loop", "fast"}},
+    {OptionKind::MAX_DYN_OPS,
+     "",
+     "--max-dyn-ops",
+     true,
+     "Limit for the estimated number of statements that the test executes "
+     "(trip counts of the loops are reduced to fit it, 0 means no limit)",
+     "Can't parse dynamic operations limit",
+     OptionParser::parseMaxDynOps,
+     "0",
+     {}},
+    {OptionKind::MAX_COMPILE_COST,
+     "",
+     "--max-compile-cost",
+     true,
+     "Limit for the estimated compile cost of the test (expressions are cut "
+     "short when the limit is reached, 0 means no limit)",
+     "Can't parse compile cost limit",
+     OptionParser::parseMaxCompileCost,
+     "0",
+     {}},
+    {OptionKind::STATS_JSON,
+     "",
+     "--stats-json",
+     true,
+     "Write the generation statistics and the time of each generation phase "
+     "to the file in JSON format",
+     "Can't parse statistics file name",
+     OptionParser::parseStatsJson,
+     "",
+     {}},
+    {OptionKind::MEM_REPORT,
+     "",
+     "--mem-report",
+     false,
+     "Count live and peak numbers of the IR objects and print the memory "
+     "report to stderr (and to the statistics file)",
+     "Can't parse memory report option",
+     OptionParser::parseMemReport,
+     "false",
+     {"true", "false"}},
+    {OptionKind::STMT_NUM_LIM,
+     "",
+     "--stmt-num-lim",
+     true,
+     "Limit for the number of statements in the test",
+     "Can't parse statements number limit",
+     OptionParser::parseStmtNumLim,
+     "1000",
+     {}},
+    {OptionKind::MAX_ARITH_DEPTH,
+     "",
+     "--max-arith-depth",
+     true,
+     "Maximal depth of arithmetic expression trees (up to " +
+         std::to_string(MAX_ARITH_DEPTH_LIMIT) + ")",
+     "Can't parse maximal arithmetic depth",
+     OptionParser::parseMaxArithDepth,
+     "3",
+     {}},
+    {OptionKind::TRACE,
+     "",
+     "--trace",
+     true,
+     "Write the trace of the generation to the file in Chrome trace-event "
+     "format",
+     "Can't parse trace file name",
+     OptionParser::parseTrace,
+     "",
+     {}},
+    {OptionKind::STREAM_EMIT,
+     "",
+     "--stream-emit",
+     false,
+     "Emit every top-level statement of the test function as soon as it is "
+     "populated and release its IR (reduces the memory for huge tests, can't "
+     "be used with --archive)",
+     "Can't parse streaming emission option",
+     OptionParser::parseStreamEmit,
+     "false",
+     {"true", "false"}},
+    {OptionKind::UB_FREE_OPS,
+     "",
+     "--ub-free-ops",
+     false,
+     "Pick operators that don't cause UB for the values of their operands "
+     "while creating the expressions (rebuild fixes the rest)",
+     "Can't parse UB-free operators option",
+     OptionParser::parseUBFreeOps,
+     "false",
+     {"true", "false"}},
+    {OptionKind::DEADLINE_MS,
+     "",
+     "--deadline-ms",
+     true,
+     "Time budget for the generation in milliseconds (the rest of the test "
+     "is built from the smallest constructs when it is close to running out, "
+     "0 means no limit)",
+     "Can't parse deadline",
+     OptionParser::parseDeadlineMs,
+     "0",
+     {}},
+    {OptionKind::MEM_BUDGET,
+     "",
+     "--mem-budget",
+     true,
+     "Soft limit for the size of the IR objects in kilobytes (the test gets "
+     "smaller as their size approaches it, 0 means no limit). Only the "
+     "objects themselves are counted, so RSS is several times larger",
+     "Can't parse memory budget",
+     OptionParser::parseMemBudget,
+     "0",
+     {}},
+    {OptionKind::COMPACT_EMIT,
+     "",
+     "--compact-emit",
+     false,
+     "Emit only the parentheses that change the meaning of the expressions "
+     "(the tests are smaller and faster to parse)",
+     "Can't parse compact emission option",
+     OptionParser::parseCompactEmit,
+     "false",
+     {"true", "false"}},
+    {OptionKind::EXPR_TEMPS,
+     "",
+     "--expr-temps",
+     true,
+     "Maximal nesting of the operators in the expression statements, deeper "
+     "subexpressions are moved to temporaries (0 means no limit, can't be "
+     "used with ISPC)",
+     "Can't parse expression temporaries limit",
+     OptionParser::parseExprTemps,
+     "0",
+     {}},
 };
 
 static void dumpVersion(std::ostream &stream) {
@@ -302,7 +487,7 @@ void OptionParser::parse(size_t argc, char *argv[]) {
 
     for (size_t i = 1; i < argc; ++i) {
         bool parsed = false;
-        for (const auto &item : options_set)
+        for (auto &item : options_set)
             if (parseLongAndShortArgs(argc, i, argv, item)) {
                 parsed = true;
                 break;
@@ -310,6 +495,27 @@ void OptionParser::parse(size_t argc, char *argv[]) {
         if (!parsed)
             printHelpAndExit("Unknown option: " + std::string(argv[i]));
     }
+
+    // Archive records are written with a single call, so they need the whole
+    // test in memory
+    if (options.getStreamEmit() && options.useArchive())
+        printHelpAndExit("Streaming emission can't be used with archives");
+    // ISPC doesn't allow assignments to uniform variables under varying
+    // control flow
+    if (options.useExprTemps() && options.isISPC())
+        printHelpAndExit("Expression temporaries can't be used with ISPC");
+
+    options.setOptionsHash(hashGenOptions());
+}
+
+// Options that change the generated test. The rest of them change only the
+// way we output the test (or don't produce a test at all).
+bool OptionParser::isGenOption(OptionKind kind) {
+    return kind != OptionKind::HELP && kind != OptionKind::VERSION &&
+           kind != OptionKind::SEED && kind != OptionKind::OUT_DIR &&
+           kind != OptionKind::EMIT_THREADS && kind != OptionKind::ARCHIVE &&
+           kind != OptionKind::STATS_JSON && kind != OptionKind::MEM_REPORT &&
+           kind != OptionKind::TRACE && kind != OptionKind::STREAM_EMIT;
 }
 
 void OptionParser::initOptions() {
@@ -454,6 +660,172 @@ void OptionParser::parseExplLoopParams(std::string val) {
         printHelpAndExit("Can't recognize explicit loop parameters");
 }
 
+void OptionParser::parseEmitThreads(std::string val) {
+    std::stringstream arg_ss(val);
+    Options &options = Options::getInstance();
+    size_t threads_num = 0;
+    arg_ss >> threads_num;
+    if (arg_ss.fail() || !arg_ss.eof() || threads_num == 0)
+        printHelpAndExit("Can't recognize number of emission threads");
+    options.setEmitThreads(threads_num);
+}
+
+void OptionParser::parseFuncNum(std::string val) {
+    std::stringstream arg_ss(val);
+    Options &options = Options::getInstance();
+    size_t func_num = 0;
+    arg_ss >> func_num;
+    if (arg_ss.fail() || !arg_ss.eof() || func_num == 0)
+        printHelpAndExit("Can't recognize number of test functions");
+    options.setFuncNum(func_num);
+}
+
+void OptionParser::parseArchive(std::string val) {
+    Options &options = Options::getInstance();
+    options.setArchive(std::move(val));
+}
+
+void OptionParser::parseChecksumMode(std::string val) {
+    Options &options = Options::getInstance();
+    if (val == "elem")
+        options.setChecksumMode(ChecksumMode::ELEM);
+    else if (val == "bulk")
+        options.setChecksumMode(ChecksumMode::BULK);
+    else
+        printHelpAndExit("Can't recognize checksum mode");
+}
+
+void OptionParser::parseArrayInit(std::string val) {
+    Options &options = Options::getInstance();
+    if (val == "loop")
+        options.setArrayInitMode(ArrayInitMode::LOOP);
+    else if (val == "fast")
+        options.setArrayInitMode(ArrayInitMode::FAST);
+    else
+        printHelpAndExit("Can't recognize array initialization mode");
+}
+
+void OptionParser::parseMaxDynOps(std::string val) {
+    std::stringstream arg_ss(val);
+    Options &options = Options::getInstance();
+    uint64_t max_dyn_ops = 0;
+    arg_ss >> max_dyn_ops;
+    if (arg_ss.fail() || !arg_ss.eof())
+        printHelpAndExit("Can't recognize dynamic operations limit");
+    options.setMaxDynOps(max_dyn_ops);
+}
+
+void OptionParser::parseMaxCompileCost(std::string val) {
+    std::stringstream arg_ss(val);
+    Options &options = Options::getInstance();
+    uint64_t max_compile_cost = 0;
+    arg_ss >> max_compile_cost;
+    if (arg_ss.fail() || !arg_ss.eof())
+        printHelpAndExit("Can't recognize compile cost limit");
+    options.setMaxCompileCost(max_compile_cost);
+}
+
+void OptionParser::parseStatsJson(std::string val) {
+    Options &options = Options::getInstance();
+    options.setStatsJson(std::move(val));
+}
+
+void OptionParser::parseMemReport(std::string val) {
+    Options &options = Options::getInstance();
+    if (val.empty())
+        options.setMemReport(true);
+    else if (val == "false")
+        options.setMemReport(false);
+    else
+        printHelpAndExit("Can't recognize memory report option");
+}
+
+void OptionParser::parseStmtNumLim(std::string val) {
+    std::stringstream arg_ss(val);
+    Options &options = Options::getInstance();
+    size_t stmt_num_lim = 0;
+    arg_ss >> stmt_num_lim;
+    if (arg_ss.fail() || !arg_ss.eof() || stmt_num_lim == 0)
+        printHelpAndExit("Can't recognize statements number limit");
+    options.setStmtNumLim(stmt_num_lim);
+}
+
+void OptionParser::parseMaxArithDepth(std::string val) {
+    std::stringstream arg_ss(val);
+    Options &options = Options::getInstance();
+    size_t max_arith_depth = 0;
+    arg_ss >> max_arith_depth;
+    if (arg_ss.fail() || !arg_ss.eof() || max_arith_depth == 0 ||
+        max_arith_depth > MAX_ARITH_DEPTH_LIMIT)
+        printHelpAndExit("Can't recognize maximal arithmetic depth");
+    options.setMaxArithDepth(max_arith_depth);
+}
+
+void OptionParser::parseTrace(std::string val) {
+    Options &options = Options::getInstance();
+    options.setTrace(std::move(val));
+}
+
+void OptionParser::parseStreamEmit(std::string val) {
+    Options &options = Options::getInstance();
+    if (val.empty())
+        options.setStreamEmit(true);
+    else if (val == "false")
+        options.setStreamEmit(false);
+    else
+        printHelpAndExit("Can't recognize streaming emission option");
+}
+
+void OptionParser::parseUBFreeOps(std::string val) {
+    Options &options = Options::getInstance();
+    if (val.empty())
+        options.setUBFreeOps(true);
+    else if (val == "false")
+        options.setUBFreeOps(false);
+    else
+        printHelpAndExit("Can't recognize UB-free operators option");
+}
+
+void OptionParser::parseDeadlineMs(std::string val) {
+    std::stringstream arg_ss(val);
+    Options &options = Options::getInstance();
+    uint64_t deadline_ms = 0;
+    arg_ss >> deadline_ms;
+    if (arg_ss.fail() || !arg_ss.eof())
+        printHelpAndExit("Can't recognize deadline");
+    options.setDeadlineMs(deadline_ms);
+}
+
+void OptionParser::parseMemBudget(std::string val) {
+    std::stringstream arg_ss(val);
+    Options &options = Options::getInstance();
+    uint64_t mem_budget = 0;
+    arg_ss >> mem_budget;
+    if (arg_ss.fail() || !arg_ss.eof())
+        printHelpAndExit("Can't recognize memory budget");
+    options.setMemBudget(mem_budget);
+}
+
+void OptionParser::parseCompactEmit(std::string val) {
+    Options &options = Options::getInstance();
+    if (val.empty())
+        options.setCompactEmit(true);
+    else if (val == "false")
+        options.setCompactEmit(false);
+    else
+        printHelpAndExit("Can't recognize compact emission option");
+}
+
+void OptionParser::parseExprTemps(std::string val) {
+    std::stringstream arg_ss(val);
+    Options &options = Options::getInstance();
+    size_t expr_temps = 0;
+    arg_ss >> expr_temps;
+    if (arg_ss.fail() || !arg_ss.eof())
+        printHelpAndExit("Can't recognize expression temporaries limit");
+    options.setExprTemps(expr_temps);
+}
+
 void Options::dump(std::ostream &stream) {
     dumpVersion(stream);
     stream << "Seed: " << seed << "\n";
@@ -464,6 +836,77 @@ void Options::dump(std::ostream &stream) {
     stream << "\n";
 }
 
+// Parsed value of the option that changes the generated test
+std::string OptionParser::getGenOptionValue(OptionKind kind) {
+    Options &options = Options::getInstance();
+    auto to_str = [](uint64_t val) { return std::to_string(val); };
+    switch (kind) {
+        case OptionKind::STD:
+            return to_str(static_cast<uint64_t>(options.getLangStd()));
+        case OptionKind::ASSERTS:
+            return to_str(static_cast<uint64_t>(options.useAsserts()));
+        case OptionKind::INP_AS_ARGS:
+            return to_str(static_cast<uint64_t>(options.inpAsArgs()));
+        case OptionKind::EMIT_ALIGN_ATTR:
+            return to_str(static_cast<uint64_t>(options.getEmitAlignAttr()));
+        case OptionKind::UNIQUE_ALIGN_SIZE:
+            return to_str(options.getUniqueAlignSize());
+        case OptionKind::ALIGN_SIZE:
+            return to_str(static_cast<uint64_t>(options.getAlignSize()));
+        case OptionKind::ALLOW_DEAD_DATA:
+            return to_str(options.getAllowDeadData());
+        case OptionKind::EMIT_PRAGMAS:
+            return to_str(static_cast<uint64_t>(options.getEmitPragmas()));
+        case OptionKind::PARAM_SHUFFLE:
+            return to_str(options.getUseParamShuffle());
+        case OptionKind::EXPL_LOOP_PARAM:
+            return to_str(options.getExplLoopParams());
+        case OptionKind::FUNC_NUM:
+            return to_str(options.getFuncNum());
+        case OptionKind::CHECKSUM_MODE:
+            return to_str(static_cast<uint64_t>(options.getChecksumMode()));
+        case OptionKind::ARRAY_INIT:
+            return to_str(static_cast<uint64_t>(options.getArrayInitMode()));
+        case OptionKind::MAX_DYN_OPS:
+            return to_str(options.getMaxDynOps());
+        case OptionKind::MAX_COMPILE_COST:
+            return to_str(options.getMaxCompileCost());
+        case OptionKind::STMT_NUM_LIM:
+            return to_str(options.getStmtNumLim());
+        case OptionKind::MAX_ARITH_DEPTH:
+            return to_str(options.getMaxArithDepth());
+        case OptionKind::UB_FREE_OPS:
+            return to_str(options.getUBFreeOps());
+        case OptionKind::DEADLINE_MS:
+            return to_str(options.getDeadlineMs());
+        case OptionKind::MEM_BUDGET:
+            return to_str(options.getMemBudget());
+        case OptionKind::COMPACT_EMIT:
+            return to_str(options.getCompactEmit());
+        case OptionKind::EXPR_TEMPS:
+            return to_str(options.getExprTemps());
+        default:
+            ERROR("Option doesn't change the test");
+    }
+}
+
+// We hash the parsed values of all of the options that change the test, so
+// the order and the spelling of the options don't matter. Omitted options
+// have the same hash as the options with default values.
+uint64_t OptionParser::hashGenOptions() {
+    uint64_t hash = Hash::FNV_OFFSET_BASIS;
+    for (auto &item : options_set) {
+        if (!isGenOption(item.getKind()))
+            continue;
+        std::string option =
+            item.getLongArg() + "=" + getGenOptionValue(item.getKind());
+        // Null character is a separator, so "ab c" and "a bc" have different
+        // hashes
+        hash = Hash::hashBytes(option.c_str(), option.size() + 1, hash);
+    }
+    return hash;
+}
+
 void Options::setRawOptions(size_t argc, char *argv[]) {
     raw_options.reserve(argc);
     for (size_t i = 0; i < argc; ++i)
@@ -19,6 +19,7 @@ limitations under the License.
 #pragma once
 
 #include "enums.h"
+#include <cstdint>
 #include <cstdlib>
 #include <functional>
 #include <map>
@@ -82,6 +83,9 @@ class OptionParser {
                              OptionDescr option);
     static bool parseLongAndShortArgs(int argc, size_t &argv_iter, char **&argv,
                                       OptionDescr option);
+    static bool isGenOption(OptionKind kind);
+    static std::string getGenOptionValue(OptionKind kind);
+    static uint64_t hashGenOptions();
 
     static void parseSeed(std::string seed_str);
     static void parseStandard(std::string std);
@@ -95,6 +99,24 @@ class OptionParser {
     static void parseOutDir(std::string val);
     static void parseUseParamShuffle(std::string val);
     static void parseExplLoopParams(std::string val);
+    static void parseEmitThreads(std::string val);
+    static void parseFuncNum(std::string val);
+    static void parseArchive(std::string val);
+    static void parseChecksumMode(std::string val);
+    static void parseArrayInit(std::string val);
+    static void parseMaxDynOps(std::string val);
+    static void parseMaxCompileCost(std::string val);
+    static void parseStatsJson(std::string val);
+    static void parseMemReport(std::string val);
+    static void parseStmtNumLim(std::string val);
+    static void parseMaxArithDepth(std::string val);
+    static void parseTrace(std::string val);
+    static void parseStreamEmit(std::string val);
+    static void parseUBFreeOps(std::string val);
+    static void parseDeadlineMs(std::string val);
+    static void parseMemBudget(std::string val);
+    static void parseCompactEmit(std::string val);
+    static void parseExprTemps(std::string val);
 };
 
 class Options {
@@ -107,6 +129,10 @@ class Options {
     Options &operator=(const Options &) = delete;
 
     void setRawOptions(size_t argc, char *argv[]);
+    // Hash of the options that affect the generated test. They identify the
+    // test together with the seed.
+    void setOptionsHash(uint64_t val) { options_hash = val; }
+    uint64_t getOptionsHash() { return options_hash; }
 
     void setSeed(size_t _seed) { seed = _seed; }
     size_t getSeed() { return seed; }
@@ -148,6 +174,68 @@ class Options {
     void setExplLoopParams(bool val) { expl_loop_params = val; }
     bool getExplLoopParams() { return expl_loop_params; }
 
+    void setEmitThreads(size_t val) { emit_threads = val; }
+    size_t getEmitThreads() { return emit_threads; }
+
+    void setFuncNum(size_t val) { func_num = val; }
+    size_t getFuncNum() { return func_num; }
+
+    void setArchive(std::string val) { archive = std::move(val); }
+    std::string getArchive() { return archive; }
+    bool useArchive() { return !archive.empty(); }
+
+    void setChecksumMode(ChecksumMode val) { checksum_mode = val; }
+    ChecksumMode getChecksumMode() { return checksum_mode; }
+
+    void setArrayInitMode(ArrayInitMode val) { array_init_mode = val; }
+    ArrayInitMode getArrayInitMode() { return array_init_mode; }
+
+    void setMaxDynOps(uint64_t val) { max_dyn_ops = val; }
+    uint64_t getMaxDynOps() { return max_dyn_ops; }
+    bool useDynOpsBudget() { return max_dyn_ops != 0; }
+
+    void setMaxCompileCost(uint64_t val) { max_compile_cost = val; }
+    uint64_t getMaxCompileCost() { return max_compile_cost; }
+    bool useCompileCostBudget() { return max_compile_cost != 0; }
+
+    void setStatsJson(std::string val) { stats_json = std::move(val); }
+    std::string getStatsJson() { return stats_json; }
+    bool useStatsJson() { return !stats_json.empty(); }
+
+    void setMemReport(bool val) { mem_report = val; }
+    bool getMemReport() { return mem_report; }
+
+    void setStmtNumLim(size_t val) { stmt_num_lim = val; }
+    size_t getStmtNumLim() { return stmt_num_lim; }
+
+    void setMaxArithDepth(size_t val) { max_arith_depth = val; }
+    size_t getMaxArithDepth() { return max_arith_depth; }
+
+    void setTrace(std::string val) { trace = std::move(val); }
+    std::string getTrace() { return trace; }
+    bool useTrace() { return !trace.empty(); }
+
+    void setStreamEmit(bool val) { stream_emit = val; }
+    bool getStreamEmit() { return stream_emit; }
+
+    void setUBFreeOps(bool val) { ub_free_ops = val; }
+    bool getUBFreeOps() { return ub_free_ops; }
+
+    void setDeadlineMs(uint64_t val) { deadline_ms = val; }
+    uint64_t getDeadlineMs() { return deadline_ms; }
+    bool useDeadline() { return deadline_ms != 0; }
+
+    void setMemBudget(uint64_t val) { mem_budget = val; }
+    uint64_t getMemBudget() { return mem_budget; }
+    bool useMemBudget() { return mem_budget != 0; }
+
+    void setCompactEmit(bool val) { compact_emit = val; }
+    bool getCompactEmit() { return compact_emit; }
+
+    void setExprTemps(size_t val) { expr_temps = val; }
+    size_t getExprTemps() { return expr_temps; }
+    bool useExprTemps() { return expr_temps != 0; }
+
     void dump(std::ostream &stream);
 
   private:
@@ -157,7 +245,13 @@ class Options {
           unique_align_size(false),
           align_size(AlignmentSize::MAX_ALIGNMENT_SIZE), allow_dead_data(false),
           emit_pragmas(OptionLevel::SOME), out_dir("."),
-          use_param_shuffle(false) {}
+          use_param_shuffle(false), expl_loop_params(false),
+          emit_threads(1), func_num(1), checksum_mode(ChecksumMode::ELEM),
+          array_init_mode(ArrayInitMode::LOOP), max_dyn_ops(0),
+          max_compile_cost(0), mem_report(false),
+          stmt_num_lim(1000), max_arith_depth(3), stream_emit(false),
+          ub_free_ops(false), deadline_ms(0), mem_budget(0),
+          compact_emit(false), expr_temps(0), options_hash(0) {}
 
     std::vector<std::string> raw_options;
 
@@ -182,5 +276,58 @@ class Options {
 
     // Explicit loop parameters. Some applications need that option available
     bool expl_loop_params;
+
+    // Number of threads for the emission of the test files
+    size_t emit_threads;
+
+    // Number of test functions. Each of them goes to a separate file, so they
+    // can be compiled in parallel
+    size_t func_num;
+
+    // Append the test to the archive instead of writing separate files
+    std::string archive;
+
+    ChecksumMode checksum_mode;
+    ArrayInitMode array_init_mode;
+
+    // Upper bound for the estimated number of dynamically executed statements
+    // of the test (0 means no limit)
+    uint64_t max_dyn_ops;
+    // Upper bound for the estimated compile cost of the test (0 means no
+    // limit). See Statistics for the cost model.
+    uint64_t max_compile_cost;
+
+    // Write the generation statistics and timers to this file
+    std::string stats_json;
+
+    // Count the IR objects and report the memory usage
+    bool mem_report;
+
+    // Scale of the test (see GenPolicy)
+    size_t stmt_num_lim;
+    size_t max_arith_depth;
+
+    std::string trace;
+
+    // Emit the test function statement by statement during the population
+    bool stream_emit;
+
+    // Pick operators that don't cause UB while creating the expressions
+    bool ub_free_ops;
+
+    // Time budget for the generation in milliseconds (0 means no limit).
+    // See Statistics::pastDeadline.
+    uint64_t deadline_ms;
+    // Soft memory limit in kilobytes (0 means no limit).
+    // See Statistics::shrinkForMemBudget.
+    uint64_t mem_budget;
+
+    // Emit only the parentheses that change the meaning of the expressions
+    bool compact_emit;
+    // Maximal nesting of the operators in the expression statements. Deeper
+    // subexpressions go to temporaries (0 means no limit).
+    size_t expr_temps;
+
+    uint64_t options_hash;
 };
 } // namespace yarpgen
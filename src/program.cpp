@@ -16,19 +16,33 @@ limitations under the License.
 //////////////////////////////////////////////////////////////////////////////
 
 #include "program.h"
+#include "archive.h"
 #include "data.h"
 #include "emit_policy.h"
+#include "statistics.h"
 #include "stmt.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
 #include <memory>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 using namespace yarpgen;
 
 ProgramGenerator::ProgramGenerator() {
     // Generate the general structure of the test
     auto gen_ctx = std::make_shared<GenCtx>();
-    new_test = ScopeStmt::generateStructure(gen_ctx);
+    {
+        ScopedTimer timer(GenPhase::GEN_STRUCTURE);
+        new_test = ScopeStmt::generateStructure(gen_ctx);
+    }
+    // Every statement is executed at least once. Loops add the rest of their
+    // iterations to the estimate when we populate them.
+    Statistics::getInstance().addDynOps(new_test->countStmts());
 
     // Prepare to generate some math inside the structure
     ext_inp_sym_tbl = std::make_shared<SymbolTable>();
@@ -50,11 +64,148 @@ ProgramGenerator::ProgramGenerator() {
     pop_ctx->setExtInpSymTable(ext_inp_sym_tbl);
     pop_ctx->setExtOutSymTable(ext_out_sym_tbl);
 
-    new_test->populate(pop_ctx);
+    {
+        ScopedTimer timer(GenPhase::POPULATE);
+        if (!Options::getInstance().getStreamEmit())
+            new_test->populate(pop_ctx);
+        else
+            populateAndStream(pop_ctx);
+    }
+
+    prepareEmission();
+}
+
+// Offset of the body of the test function
+static Indent getTestOffset() {
+    return !Options::getInstance().isSYCL() ? Indent() : Indent(3);
+}
+
+void ProgramGenerator::populateAndStream(std::shared_ptr<PopulateCtx> ctx) {
+    // Statement emission doesn't depend on anything that we decide after the
+    // population, so the result is the same as in the usual mode
+    Options &options = Options::getInstance();
+    spool = std::make_shared<StmtSpool>(options.getOutDir() + "/func.spool");
+    auto emit_ctx = std::make_shared<EmitCtx>();
+    emit_ctx->setIspcTypes(options.isISPC());
+    emit_ctx->setSYCLAccess(options.isSYCL());
+    Indent offset = getTestOffset().next();
+    SourceWriter stmt_stream;
+    new_test->populateAndRelease(
+        std::move(ctx),
+        [this, &emit_ctx, offset, &stmt_stream](std::shared_ptr<Stmt> stmt) {
+            ScopedTimer timer(GenPhase::EMIT_TEST);
+            stmt_stream.clear();
+            StmtBlock::emitStmt(emit_ctx, stmt_stream, offset, stmt);
+            spool->append(stmt_stream);
+        });
+}
+
+void ProgramGenerator::prepareEmission() {
+    Options &options = Options::getInstance();
+    EmitPolicy emit_pol;
+
+    // We need to narrow options if we were asked to do so
+    if (options.getUniqueAlignSize() &&
+        options.getAlignSize() == AlignmentSize::MAX_ALIGNMENT_SIZE) {
+        AlignmentSize align_size =
+            rand_val_gen->getRandId(emit_pol.align_size_distr);
+        options.setAlignSize(align_size);
+    }
+
+    auto is_emitted = [&options](std::shared_ptr<Data> data) -> bool {
+        return options.getAllowDeadData() || !data->getIsDead();
+    };
+
+    auto pass_as_param = [&options, &emit_pol]() -> bool {
+        if (options.inpAsArgs() == OptionLevel::SOME)
+            return rand_val_gen->getRandId(emit_pol.pass_as_param_distr);
+        return options.inpAsArgs() == OptionLevel::ALL;
+    };
+
+    auto choose_alignment = [&options, &emit_pol]() -> size_t {
+        if (!options.isCXX() || options.getEmitAlignAttr() == OptionLevel::NONE)
+            return 0;
+        bool emit_align_attr = true;
+        if (options.getEmitAlignAttr() == OptionLevel::SOME)
+            emit_align_attr =
+                rand_val_gen->getRandId(emit_pol.emit_align_attr_distr);
+        if (!emit_align_attr)
+            return 0;
+
+        AlignmentSize align_size = options.getAlignSize();
+        if (!options.getUniqueAlignSize())
+            align_size = rand_val_gen->getRandId(emit_pol.align_size_distr);
+        switch (align_size) {
+            case AlignmentSize::A16:
+                return 16;
+            case AlignmentSize::A32:
+                return 32;
+            case AlignmentSize::A64:
+                return 64;
+            case AlignmentSize::MAX_ALIGNMENT_SIZE:
+                ERROR("Bad alignment size");
+        }
+        return 0;
+    };
+
+    auto use_assert = [&options, &emit_pol]() -> bool {
+        if (options.useAsserts() == OptionLevel::SOME)
+            return rand_val_gen->getRandId(emit_pol.asserts_check_distr);
+        return options.useAsserts() == OptionLevel::ALL;
+    };
+
+    for (auto &var : ext_inp_sym_tbl->getVars())
+        if (is_emitted(var))
+            var->setPassAsParam(pass_as_param());
+
+    for (auto &array : ext_inp_sym_tbl->getArrays()) {
+        if (!is_emitted(array))
+            continue;
+        array->setPassAsParam(pass_as_param());
+        if (!array->getPassAsParam())
+            array->setAlignment(choose_alignment());
+    }
+
+    for (auto &array : ext_out_sym_tbl->getArrays())
+        if (is_emitted(array))
+            array->setAlignment(choose_alignment());
+
+    for (auto &var : ext_out_sym_tbl->getVars())
+        var->setUseAssert(use_assert());
+
+    for (auto &array : ext_out_sym_tbl->getArrays())
+        array->setUseAssert(use_assert());
+
+    // Top-level statements communicate only through the external data, so
+    // executing the parts one after another gives the same result as the
+    // whole test
+    auto stmts = new_test->getStmts();
+    size_t func_num = options.getFuncNum();
+    test_parts.clear();
+    if (spool)
+        return;
+    if (func_num == 1) {
+        test_parts.push_back(new_test);
+        return;
+    }
+    for (size_t i = 0; i < func_num; ++i) {
+        auto part = std::make_shared<ScopeStmt>();
+        for (size_t j = stmts.size() * i / func_num;
+             j < stmts.size() * (i + 1) / func_num; ++j)
+            part->addStmt(stmts[j]);
+        test_parts.push_back(part);
+    }
+}
+
+// Name of the test function and the suffix of the file that contains it
+static std::string getFuncSuffix(size_t func_idx) {
+    if (Options::getInstance().getFuncNum() == 1)
+        return "";
+    return "_" + std::to_string(func_idx);
 }
 
-void ProgramGenerator::emitCheckFunc(std::ostream &stream) {
-    std::ostream &out_file = stream;
+void ProgramGenerator::emitCheckFunc(SourceWriter &stream) {
+    SourceWriter &out_file = stream;
     out_file << "#include <stdio.h>\n\n";
 
     Options &options = Options::getInstance();
@@ -65,14 +216,69 @@ void ProgramGenerator::emitCheckFunc(std::ostream &stream) {
             stream << "#include <cassert>\n\n";
     }
 
+    if (options.getChecksumMode() == ChecksumMode::BULK ||
+        options.getArrayInitMode() == ArrayInitMode::FAST)
+        out_file << "#include <string.h>\n\n";
+
     out_file << "unsigned long long int seed = 0;\n";
     out_file << "void hash(unsigned long long int *seed, unsigned long long "
                 "int const v) {\n";
     out_file << "    *seed ^= v + 0x9e3779b9 + ((*seed)<<6) + ((*seed)>>2);\n";
     out_file << "}\n\n";
+
+    if (options.getChecksumMode() == ChecksumMode::BULK)
+        emitBulkHashFunc(out_file);
 }
 
-static void emitVarsDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
+// Hashes the whole storage of an array. Four independent lanes consume 8
+// bytes each per iteration, so there is no dependency chain between
+// neighbouring elements and the loop can be vectorized. The tail is padded
+// with zeroes and the lanes are combined with the size at the end.
+void ProgramGenerator::emitBulkHashFunc(SourceWriter &stream) {
+    stream << "#define HASH_LANE(lane, v) \\\n"
+              "    lane = ((lane) ^ (v)) * 0xbf58476d1ce4e5b9ULL; \\\n"
+              "    lane ^= (lane) >> 31\n"
+              "#define HASH_FINALIZE(lane) \\\n"
+              "    lane ^= (lane) >> 30; \\\n"
+              "    lane *= 0x94d049bb133111ebULL; \\\n"
+              "    lane ^= (lane) >> 27\n\n";
+
+    stream << "void hash_bytes(unsigned long long int *seed, const void *data, "
+              "unsigned long long int size) {\n";
+    stream << "    const unsigned char *bytes = "
+              "(const unsigned char *) data;\n";
+    stream << "    unsigned long long int lane_0 = 0x9e3779b97f4a7c15ULL;\n";
+    stream << "    unsigned long long int lane_1 = 0x7f4a7c159e3779b9ULL;\n";
+    stream << "    unsigned long long int lane_2 = 0xbf58476d1ce4e5b9ULL;\n";
+    stream << "    unsigned long long int lane_3 = 0x94d049bb133111ebULL;\n";
+    stream << "    unsigned long long int v[4];\n";
+    stream << "    unsigned long long int i = 0;\n";
+    stream << "    for (; i + sizeof(v) <= size; i += sizeof(v)) {\n";
+    stream << "        memcpy(v, bytes + i, sizeof(v));\n";
+    stream << "        HASH_LANE(lane_0, v[0]);\n";
+    stream << "        HASH_LANE(lane_1, v[1]);\n";
+    stream << "        HASH_LANE(lane_2, v[2]);\n";
+    stream << "        HASH_LANE(lane_3, v[3]);\n";
+    stream << "    }\n";
+    stream << "    memset(v, 0, sizeof(v));\n";
+    stream << "    memcpy(v, bytes + i, size - i);\n";
+    stream << "    HASH_LANE(lane_0, v[0]);\n";
+    stream << "    HASH_LANE(lane_1, v[1]);\n";
+    stream << "    HASH_LANE(lane_2, v[2]);\n";
+    stream << "    HASH_LANE(lane_3, v[3]);\n";
+    stream << "    HASH_FINALIZE(lane_0);\n";
+    stream << "    HASH_FINALIZE(lane_1);\n";
+    stream << "    HASH_FINALIZE(lane_2);\n";
+    stream << "    HASH_FINALIZE(lane_3);\n";
+    stream << "    hash(seed, size);\n";
+    stream << "    hash(seed, lane_0);\n";
+    stream << "    hash(seed, lane_1);\n";
+    stream << "    hash(seed, lane_2);\n";
+    stream << "    hash(seed, lane_3);\n";
+    stream << "}\n\n";
+}
+
+static void emitVarsDecl(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
                          std::vector<std::shared_ptr<ScalarVar>> vars) {
     Options &options = Options::getInstance();
     if (options.isSYCL())
@@ -88,7 +294,7 @@ static void emitVarsDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
     ctx->setSYCLPrefix("");
 }
 
-static void emitArrayDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
+static void emitArrayDecl(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
                           std::vector<std::shared_ptr<Array>> arrays) {
     Options &options = Options::getInstance();
     for (auto &array : arrays) {
@@ -110,7 +316,7 @@ static void emitArrayDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
 }
 
 void ProgramGenerator::emitDecl(std::shared_ptr<EmitCtx> ctx,
-                                std::ostream &stream) {
+                                SourceWriter &stream) {
     emitVarsDecl(ctx, stream, ext_inp_sym_tbl->getVars());
     emitVarsDecl(ctx, stream, ext_out_sym_tbl->getVars());
 
@@ -118,13 +324,68 @@ void ProgramGenerator::emitDecl(std::shared_ptr<EmitCtx> ctx,
     emitArrayDecl(ctx, stream, ext_out_sym_tbl->getArrays());
 }
 
-static void emitArrayInit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
+// Checks if all bytes of the value are the same, so it can be set with memset
+static bool isByteUniform(IRValue val, size_t bit_size, uint8_t &byte) {
+    uint64_t bits = val.castToType(IntTypeID::ULLONG).getValueRef<uint64_t>();
+    byte = static_cast<uint8_t>(bits & 0xff);
+    for (size_t i = 1; i < bit_size / CHAR_BIT; ++i)
+        if (((bits >> (i * CHAR_BIT)) & 0xff) != byte)
+            return false;
+    return true;
+}
+
+// Initializes the array without a loop nest. Global arrays are zero
+// initialized, so zero values need nothing. Values with the same bytes are
+// set with memset. Otherwise we set the first element and copy the
+// initialized part of the array over the rest of it, doubling the size each
+// time.
+static void emitFastArrayInit(std::shared_ptr<EmitCtx> ctx,
+                              SourceWriter &stream,
+                              const std::shared_ptr<Array> &array) {
+    auto array_type = std::static_pointer_cast<ArrayType>(array->getType());
+    auto init_var = array->getInitValues();
+    assert(init_var->getKind() == DataKind::VAR &&
+           "We support simple array for now");
+    IRValue init_val =
+        std::static_pointer_cast<ScalarVar>(init_var)->getInitValue();
+    auto base_type =
+        std::static_pointer_cast<IntegralType>(array_type->getBaseType());
+
+    std::string name = array->getName(ctx);
+    uint8_t byte = 0;
+    if (isByteUniform(init_val, base_type->getBitSize(), byte)) {
+        if (byte != 0)
+            stream << "    memset(" << name << ", "
+                   << static_cast<unsigned>(byte) << ", sizeof("
+                   << name << "));\n";
+        return;
+    }
+
+    std::string first_elem = name + " ";
+    for (size_t i = 0; i < array_type->getDimensions().size(); ++i)
+        first_elem += "[0] ";
+    stream << "    " << first_elem << "= ";
+    auto init_const = std::make_shared<ConstantExpr>(init_val);
+    init_const->emit(ctx, stream);
+    stream << ";\n";
+    stream << "    for (size_t n = sizeof(" << first_elem << "); n < sizeof("
+           << name << "); n *= 2)\n";
+    stream << "        memcpy((char *) " << name << " + n, " << name
+           << ", n < sizeof(" << name << ") - n ? n : sizeof(" << name
+           << ") - n);\n";
+}
+
+static void emitArrayInit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
                           std::vector<std::shared_ptr<Array>> arrays) {
     Options &options = Options::getInstance();
     for (const auto &array : arrays) {
         if (!options.getAllowDeadData() && array->getIsDead())
             continue;
-        std::string offset = "    ";
+        if (options.getArrayInitMode() == ArrayInitMode::FAST) {
+            emitFastArrayInit(ctx, stream, array);
+            continue;
+        }
+        Indent offset(1);
         auto type = array->getType();
         assert(type->isArrayType() && "Array should have an Array type");
         auto array_type = std::static_pointer_cast<ArrayType>(type);
@@ -132,7 +393,7 @@ static void emitArrayInit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
         for (const auto &dimension : array_type->getDimensions()) {
             stream << offset << "for (size_t i_" << idx << " = 0; i_" << idx
                    << " < " << dimension << "; ++i_" << idx << ") \n";
-            offset += "    ";
+            offset = offset.next();
             idx++;
         }
         stream << offset << array->getName(ctx) << " ";
@@ -151,7 +412,7 @@ static void emitArrayInit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
 }
 
 void ProgramGenerator::emitInit(std::shared_ptr<EmitCtx> ctx,
-                                std::ostream &stream) {
+                                SourceWriter &stream) {
     stream << "void init() {\n";
     emitArrayInit(ctx, stream, ext_inp_sym_tbl->getArrays());
     emitArrayInit(ctx, stream, ext_out_sym_tbl->getArrays());
@@ -159,26 +420,18 @@ void ProgramGenerator::emitInit(std::shared_ptr<EmitCtx> ctx,
 }
 
 void ProgramGenerator::emitCheck(std::shared_ptr<EmitCtx> ctx,
-                                 std::ostream &stream) {
+                                 SourceWriter &stream) {
     stream << "void checksum() {\n";
 
     Options &options = Options::getInstance();
 
-    auto emit_pol = ctx->getEmitPolicy();
-
     if (options.isSYCL())
         ctx->setSYCLPrefix("app_");
 
     for (auto &var : ext_out_sym_tbl->getVars()) {
-        bool use_assert = false;
-        if (options.useAsserts() == OptionLevel::SOME)
-            use_assert = rand_val_gen->getRandId(emit_pol->asserts_check_distr);
-        else if (options.useAsserts() == OptionLevel::ALL)
-            use_assert = true;
-
         std::string var_name = var->getName(ctx);
 
-        if (!use_assert) {
+        if (!var->getUseAssert()) {
             stream << "    hash(&seed, " << var_name << ");\n";
         }
         else {
@@ -192,8 +445,18 @@ void ProgramGenerator::emitCheck(std::shared_ptr<EmitCtx> ctx,
 
     ctx->setSYCLPrefix("");
 
+    bool bulk_checksum = options.getChecksumMode() == ChecksumMode::BULK;
     for (const auto &array : ext_out_sym_tbl->getArrays()) {
-        std::string offset = "    ";
+        // Arrays are contiguous, so we can hash all of the elements at once.
+        // Asserts still need to check every element.
+        if (bulk_checksum && !array->getUseAssert()) {
+            std::string name = array->getName(ctx);
+            stream << "    hash_bytes(&seed, " << name << ", sizeof(" << name
+                   << "));\n";
+            continue;
+        }
+
+        Indent offset(1);
         auto type = array->getType();
         assert(type->isArrayType() && "Array should have an Array type");
         auto array_type = std::static_pointer_cast<ArrayType>(type);
@@ -201,16 +464,11 @@ void ProgramGenerator::emitCheck(std::shared_ptr<EmitCtx> ctx,
         for (const auto &dimension : array_type->getDimensions()) {
             stream << offset << "for (size_t i_" << idx << " = 0; i_" << idx
                    << " < " << dimension << "; ++i_" << idx << ") \n";
-            offset += "    ";
+            offset = offset.next();
             idx++;
         }
 
-        bool use_assert = false;
-        if (options.useAsserts() == OptionLevel::SOME)
-            use_assert = rand_val_gen->getRandId(emit_pol->asserts_check_distr);
-        else if (options.useAsserts() == OptionLevel::ALL)
-            use_assert = true;
-
+        bool use_assert = array->getUseAssert();
         if (!use_assert)
             stream << offset << "hash(&seed, ";
         else
@@ -243,35 +501,16 @@ void ProgramGenerator::emitCheck(std::shared_ptr<EmitCtx> ctx,
     stream << "}\n";
 }
 
-// This buffer tracks what input data we pass as a parameters to test functions
-static std::vector<std::string> pass_as_param_buffer;
-static bool any_vars_as_params = false;
-static bool any_arrays_as_params = false;
-
-static void emitVarExtDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                           std::vector<std::shared_ptr<ScalarVar>> vars,
-                           bool inp_category) {
-    auto emit_pol = ctx->getEmitPolicy();
+static void emitVarExtDecl(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                           std::vector<std::shared_ptr<ScalarVar>> vars) {
     Options &options = Options::getInstance();
     if (options.isSYCL())
         ctx->setSYCLPrefix("app_");
     for (auto &var : vars) {
         if (!options.getAllowDeadData() && var->getIsDead())
             continue;
-        bool pass_as_param = false;
-        if (inp_category) {
-            if (options.inpAsArgs() == OptionLevel::SOME)
-                pass_as_param =
-                    rand_val_gen->getRandId(emit_pol->pass_as_param_distr);
-            else if (options.inpAsArgs() == OptionLevel::ALL)
-                pass_as_param = true;
-        }
-
-        if (pass_as_param) {
-            pass_as_param_buffer.push_back(var->getName(ctx));
-            any_vars_as_params = true;
+        if (var->getPassAsParam())
             continue;
-        }
         stream << "extern ";
         stream << var->getType()->getName(ctx);
         stream << " ";
@@ -280,28 +519,14 @@ static void emitVarExtDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
     ctx->setSYCLPrefix("");
 }
 
-static void emitArrayExtDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                             std::vector<std::shared_ptr<Array>> arrays,
-                             bool inp_category) {
-    auto emit_pol = ctx->getEmitPolicy();
+static void emitArrayExtDecl(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                             std::vector<std::shared_ptr<Array>> arrays) {
     Options &options = Options::getInstance();
     for (auto &array : arrays) {
         if (!options.getAllowDeadData() && array->getIsDead())
             continue;
-        bool pass_as_param = false;
-        if (inp_category) {
-            if (options.inpAsArgs() == OptionLevel::SOME)
-                pass_as_param =
-                    rand_val_gen->getRandId(emit_pol->pass_as_param_distr);
-            else if (options.inpAsArgs() == OptionLevel::ALL)
-                pass_as_param = true;
-        }
-
-        if (pass_as_param) {
-            pass_as_param_buffer.push_back(array->getName(ctx));
-            any_arrays_as_params = true;
+        if (array->getPassAsParam())
             continue;
-        }
 
         auto type = array->getType();
         assert(type->isArrayType() && "Array should have an Array type");
@@ -314,55 +539,29 @@ static void emitArrayExtDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
             stream << "[" << dimension << "] ";
         }
 
-        if (options.isCXX() &&
-            options.getEmitAlignAttr() != OptionLevel::NONE) {
-            bool emit_align_attr = true;
-            if (options.getEmitAlignAttr() == OptionLevel::SOME)
-                emit_align_attr =
-                    rand_val_gen->getRandId(emit_pol->emit_align_attr_distr);
-            if (emit_align_attr) {
-                AlignmentSize align_size = options.getAlignSize();
-                if (!options.getUniqueAlignSize())
-                    align_size =
-                        rand_val_gen->getRandId(emit_pol->align_size_distr);
-                size_t alignment = 0;
-                switch (align_size) {
-                    case AlignmentSize::A16:
-                        alignment = 16;
-                        break;
-                    case AlignmentSize::A32:
-                        alignment = 32;
-                        break;
-                    case AlignmentSize::A64:
-                        alignment = 64;
-                        break;
-                    case AlignmentSize::MAX_ALIGNMENT_SIZE:
-                        ERROR("Bad alignment size");
-                }
-                array->setAlignment(alignment);
-                stream << "__attribute__((aligned(" << alignment << ")))";
-            }
-        }
+        if (array->getAlignment() != 0)
+            stream << "__attribute__((aligned(" << array->getAlignment()
+                   << ")))";
 
         stream << ";\n";
     }
 }
 
 void ProgramGenerator::emitExtDecl(std::shared_ptr<EmitCtx> ctx,
-                                   std::ostream &stream) {
+                                   SourceWriter &stream) {
     Options &options = Options::getInstance();
     if (options.isISPC())
         ctx->setIspcTypes(true);
-    emitVarExtDecl(ctx, stream, ext_inp_sym_tbl->getVars(), true);
-    emitVarExtDecl(ctx, stream, ext_out_sym_tbl->getVars(), false);
-    emitArrayExtDecl(ctx, stream, ext_inp_sym_tbl->getArrays(), true);
-    emitArrayExtDecl(ctx, stream, ext_out_sym_tbl->getArrays(), false);
+    emitVarExtDecl(ctx, stream, ext_inp_sym_tbl->getVars());
+    emitVarExtDecl(ctx, stream, ext_out_sym_tbl->getVars());
+    emitArrayExtDecl(ctx, stream, ext_inp_sym_tbl->getArrays());
+    emitArrayExtDecl(ctx, stream, ext_out_sym_tbl->getArrays());
     ctx->setIspcTypes(false);
 }
 
 static std::string placeSep(bool cond) { return cond ? ", " : ""; }
 
-static bool emitVarFuncParam(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
+static bool emitVarFuncParam(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
                              std::vector<std::shared_ptr<ScalarVar>> vars,
                              bool emit_type, bool ispc_type) {
     bool emit_any = false;
@@ -372,8 +571,7 @@ static bool emitVarFuncParam(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
     for (auto &var : vars) {
         if (!options.getAllowDeadData() && var->getIsDead())
             continue;
-        if (std::find(pass_as_param_buffer.begin(), pass_as_param_buffer.end(),
-                      var->getName(ctx)) == pass_as_param_buffer.end())
+        if (!var->getPassAsParam())
             continue;
 
         stream << placeSep(emit_any);
@@ -387,7 +585,7 @@ static bool emitVarFuncParam(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
 }
 
 static void emitArrayFuncParam(std::shared_ptr<EmitCtx> ctx,
-                               std::ostream &stream, bool prev_category_exist,
+                               SourceWriter &stream, bool prev_category_exist,
                                std::vector<std::shared_ptr<Array>> arrays,
                                bool emit_type, bool ispc_type, bool emit_dims) {
     bool first = true;
@@ -395,8 +593,7 @@ static void emitArrayFuncParam(std::shared_ptr<EmitCtx> ctx,
     for (auto &array : arrays) {
         if (!options.getAllowDeadData() && array->getIsDead())
             continue;
-        if (std::find(pass_as_param_buffer.begin(), pass_as_param_buffer.end(),
-                      array->getName(ctx)) == pass_as_param_buffer.end())
+        if (!array->getPassAsParam())
             continue;
 
         auto type = array->getType();
@@ -414,8 +611,8 @@ static void emitArrayFuncParam(std::shared_ptr<EmitCtx> ctx,
     }
 }
 
-void emitSYCLBuffers(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                     std::string offset,
+void emitSYCLBuffers(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                     Indent offset,
                      std::vector<std::shared_ptr<ScalarVar>> vars) {
     Options &options = Options::getInstance();
     for (auto &var : vars) {
@@ -428,8 +625,8 @@ void emitSYCLBuffers(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
     }
 }
 
-void emitSYCLAccessors(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                       std::string offset,
+void emitSYCLAccessors(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                       Indent offset,
                        std::vector<std::shared_ptr<ScalarVar>> vars,
                        bool is_inp) {
     Options &options = Options::getInstance();
@@ -443,7 +640,16 @@ void emitSYCLAccessors(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
 }
 
 void ProgramGenerator::emitTest(std::shared_ptr<EmitCtx> ctx,
-                                std::ostream &stream) {
+                                SourceWriter &stream, size_t func_idx) {
+    emitTestPrologue(ctx, stream, func_idx);
+    test_parts.at(func_idx)->emitParallel(
+        ctx, stream, getTestOffset(), Options::getInstance().getEmitThreads());
+    emitTestEpilogue(ctx, stream);
+}
+
+void ProgramGenerator::emitTestPrologue(std::shared_ptr<EmitCtx> ctx,
+                                        SourceWriter &stream,
+                                        size_t func_idx) {
     Options &options = Options::getInstance();
     stream << "#include \"init.h\"\n";
     if (options.isC()) {
@@ -463,7 +669,7 @@ void ProgramGenerator::emitTest(std::shared_ptr<EmitCtx> ctx,
         ctx->setIspcTypes(true);
         stream << "export ";
     }
-    stream << "void test(";
+    stream << "void test" << getFuncSuffix(func_idx) << "(";
 
     bool emit_any = emitVarFuncParam(ctx, stream, ext_inp_sym_tbl->getVars(),
                                      true, options.isISPC());
@@ -490,22 +696,25 @@ void ProgramGenerator::emitTest(std::shared_ptr<EmitCtx> ctx,
         stream << "        default_selector selector;\n";
         stream << "#endif\n";
         stream << "        queue myQueue(selector);\n";
-        emitSYCLBuffers(ctx, stream, "        ", ext_inp_sym_tbl->getVars());
-        emitSYCLBuffers(ctx, stream, "        ", ext_out_sym_tbl->getVars());
+        emitSYCLBuffers(ctx, stream, Indent(2), ext_inp_sym_tbl->getVars());
+        emitSYCLBuffers(ctx, stream, Indent(2), ext_out_sym_tbl->getVars());
 
         stream << "        myQueue.submit([&](handler & cgh) {\n";
-        emitSYCLAccessors(ctx, stream, "            ",
+        emitSYCLAccessors(ctx, stream, Indent(3),
                           ext_inp_sym_tbl->getVars(), true);
-        emitSYCLAccessors(ctx, stream, "            ",
+        emitSYCLAccessors(ctx, stream, Indent(3),
                           ext_out_sym_tbl->getVars(), false);
-        stream << "            cgh.single_task<class test_func>([=] ()\n";
+        stream << "            cgh.single_task<class test"
+               << getFuncSuffix(func_idx) << "_func>([=] ()\n";
     }
 
     if (options.isSYCL())
         ctx->setSYCLAccess(true);
-    new_test->emit(ctx, stream, !options.isSYCL() ? "" : "            ");
+}
 
-    if (options.isSYCL()) {
+void ProgramGenerator::emitTestEpilogue(std::shared_ptr<EmitCtx> ctx,
+                                        SourceWriter &stream) {
+    if (Options::getInstance().isSYCL()) {
         stream << "            );\n";
         stream << "        });\n";
         stream << "    }\n";
@@ -516,63 +725,57 @@ void ProgramGenerator::emitTest(std::shared_ptr<EmitCtx> ctx,
 }
 
 void ProgramGenerator::emitMain(std::shared_ptr<EmitCtx> ctx,
-                                std::ostream &stream) {
+                                SourceWriter &stream) {
     Options &options = Options::getInstance();
-    if (options.isISPC())
-        stream << "extern \"C\" { ";
+    for (size_t i = 0; i < options.getFuncNum(); ++i) {
+        if (options.isISPC())
+            stream << "extern \"C\" { ";
 
-    stream << "void test(";
+        stream << "void test" << getFuncSuffix(i) << "(";
 
-    bool emit_any =
-        emitVarFuncParam(ctx, stream, ext_inp_sym_tbl->getVars(), true, false);
-    emitArrayFuncParam(ctx, stream, emit_any, ext_inp_sym_tbl->getArrays(),
-                       true, false, true);
+        bool emit_any = emitVarFuncParam(
+            ctx, stream, ext_inp_sym_tbl->getVars(), true, false);
+        emitArrayFuncParam(ctx, stream, emit_any, ext_inp_sym_tbl->getArrays(),
+                           true, false, true);
 
-    stream << ");";
-    if (options.isISPC())
-        stream << " }\n";
-    stream << "\n\n";
+        stream << ");";
+        if (options.isISPC())
+            stream << " }\n";
+        stream << "\n";
+    }
+    stream << "\n";
     stream << "int main() {\n";
     stream << "    init();\n";
-    stream << "    test(";
 
-    emit_any =
-        emitVarFuncParam(ctx, stream, ext_inp_sym_tbl->getVars(), false, false);
+    // Test functions have to be called in the same order as the parts of the
+    // test were generated
+    for (size_t i = 0; i < options.getFuncNum(); ++i) {
+        stream << "    test" << getFuncSuffix(i) << "(";
 
-    emitArrayFuncParam(ctx, stream, emit_any, ext_inp_sym_tbl->getArrays(),
-                       false, false, false);
+        bool emit_any = emitVarFuncParam(
+            ctx, stream, ext_inp_sym_tbl->getVars(), false, false);
 
-    stream << ");\n";
+        emitArrayFuncParam(ctx, stream, emit_any, ext_inp_sym_tbl->getArrays(),
+                           false, false, false);
+
+        stream << ");\n";
+    }
     stream << "    checksum();\n";
     stream << "    printf(\"%llu\\n\", seed);\n";
     stream << "}\n";
 }
 
+// Emission creates constants, and they ask for the default integral types.
+// The type lookup table isn't thread-safe, so we create all of them in advance
+// and the emission threads only read the table.
+static void initDefaultIntTypes() {
+    for (auto id = static_cast<size_t>(IntTypeID::BOOL);
+         id < static_cast<size_t>(IntTypeID::MAX_INT_TYPE_ID); ++id)
+        IntegralType::init(static_cast<IntTypeID>(id));
+}
+
 void ProgramGenerator::emit() {
     Options &options = Options::getInstance();
-    auto emit_ctx = std::make_shared<EmitCtx>();
-    // We need to narrow options if we were asked to do so
-    if (options.getUniqueAlignSize() &&
-        options.getAlignSize() == AlignmentSize::MAX_ALIGNMENT_SIZE) {
-        AlignmentSize align_size = rand_val_gen->getRandId(
-            emit_ctx->getEmitPolicy()->align_size_distr);
-        options.setAlignSize(align_size);
-    }
-
-    std::ofstream out_file;
-
-    // TODO: probably won't work on Windows
-    std::string out_dir = options.getOutDir() + "/";
-
-    auto open_file = [&out_file, &out_dir](std::string file_name) {
-        out_file.open(out_dir + file_name);
-        if (!out_file)
-            ERROR(std::string("Can't open file ") + file_name);
-    };
-
-    open_file("init.h");
-    emitExtDecl(emit_ctx, out_file);
-    out_file.close();
 
     std::string func_file_ext, driver_file_ext;
     if (options.isC()) {
@@ -587,18 +790,162 @@ void ProgramGenerator::emit() {
         func_file_ext = "ispc";
         driver_file_ext = "cpp";
     }
-    open_file("func." + func_file_ext);
-    out_file << "/*\n";
-    options.dump(out_file);
-    out_file << "*/\n";
-    emitTest(emit_ctx, out_file);
-    out_file.close();
-
-    open_file("driver." + driver_file_ext);
-    emitCheckFunc(out_file);
-    emitDecl(emit_ctx, out_file);
-    emitInit(emit_ctx, out_file);
-    emitCheck(emit_ctx, out_file);
-    emitMain(emit_ctx, out_file);
-    out_file.close();
+
+    // init.h, test functions and the driver
+    size_t func_num = options.getFuncNum();
+    std::vector<OutputFile> out_files;
+    out_files.emplace_back("init.h", SourceWriter());
+    for (size_t i = 0; i < func_num; ++i)
+        out_files.emplace_back("func" + getFuncSuffix(i) + "." + func_file_ext,
+                               SourceWriter());
+    out_files.emplace_back("driver." + driver_file_ext, SourceWriter());
+
+    // Each file has its own context, so the files can be emitted concurrently
+    auto emit_ext_decl = [this, &out_files]() {
+        ScopedTimer timer(GenPhase::EMIT_EXT_DECL);
+        emitExtDecl(std::make_shared<EmitCtx>(), out_files.front().contents);
+    };
+
+    // In the streaming mode the bodies of the test functions are in the
+    // spool, so we emit only the parts around them
+    std::vector<SourceWriter> func_epilogues;
+    if (spool)
+        func_epilogues.resize(func_num);
+
+    auto emit_func = [this, &options, &out_files, &func_epilogues]() {
+        std::stringstream options_dump;
+        options.dump(options_dump);
+        if (options.useDynOpsBudget())
+            options_dump << "Estimated dynamic operations: "
+                         << Statistics::getInstance().getDynOpsNum() << "\n";
+        if (options.useCompileCostBudget())
+            options_dump << "Estimated compile cost: "
+                         << Statistics::getInstance().getCompileCost() << "\n";
+        for (size_t i = 0; i < out_files.size() - 2; ++i) {
+            auto emit_ctx = std::make_shared<EmitCtx>();
+            SourceWriter &out_file = out_files.at(i + 1).contents;
+            out_file << "/*\n" << options_dump.str() << "*/\n";
+            out_files.at(i + 1).header_size = out_file.size();
+            ScopedTimer timer(GenPhase::EMIT_TEST);
+            if (!spool) {
+                emitTest(emit_ctx, out_file, i);
+                continue;
+            }
+            emitTestPrologue(emit_ctx, out_file, i);
+            out_file << getTestOffset() << "{\n";
+            func_epilogues.at(i) << getTestOffset() << "}\n";
+            emitTestEpilogue(emit_ctx, func_epilogues.at(i));
+        }
+    };
+
+    auto emit_driver = [this, &out_files]() {
+        auto emit_ctx = std::make_shared<EmitCtx>();
+        SourceWriter &out_file = out_files.back().contents;
+        emitCheckFunc(out_file);
+        {
+            ScopedTimer timer(GenPhase::EMIT_DECL);
+            emitDecl(emit_ctx, out_file);
+        }
+        {
+            ScopedTimer timer(GenPhase::EMIT_INIT);
+            emitInit(emit_ctx, out_file);
+        }
+        {
+            ScopedTimer timer(GenPhase::EMIT_CHECK);
+            emitCheck(emit_ctx, out_file);
+        }
+        ScopedTimer timer(GenPhase::EMIT_MAIN);
+        emitMain(emit_ctx, out_file);
+    };
+
+    if (options.getEmitThreads() <= 1) {
+        emit_ext_decl();
+        emit_func();
+        emit_driver();
+    }
+    else {
+        initDefaultIntTypes();
+        // Test functions are the biggest ones, so they stay on the main thread
+        // and use the rest of the threads for their bodies
+        std::thread ext_decl_thread(emit_ext_decl);
+        std::thread driver_thread(emit_driver);
+        emit_func();
+        ext_decl_thread.join();
+        driver_thread.join();
+    }
+
+    ScopedTimer timer(GenPhase::WRITE);
+    if (options.useArchive()) {
+        TestArchive archive(options.getArchive());
+        archive.append(options.getSeed(), options.getOptionsHash(), out_files);
+        return;
+    }
+
+    // TODO: probably won't work on Windows
+    std::string out_dir = options.getOutDir() + "/";
+    for (size_t i = 0; i < out_files.size(); ++i) {
+        const auto &out_file = out_files.at(i);
+        bool is_func = i != 0 && i != out_files.size() - 1;
+        if (spool && is_func)
+            writeStreamedTest(out_dir + out_file.name, out_file.contents,
+                              func_epilogues.at(i - 1), i - 1);
+        else
+            out_file.contents.writeToFile(out_dir + out_file.name);
+    }
+}
+
+void ProgramGenerator::writeStreamedTest(const std::string &file_name,
+                                         const SourceWriter &prologue,
+                                         const SourceWriter &epilogue,
+                                         size_t func_idx) {
+    // Top-level statements are split between the functions in the same way
+    // as in prepareEmission()
+    size_t func_num = Options::getInstance().getFuncNum();
+    size_t stmts_num = spool->getStmtsNum();
+    std::ofstream out_file(file_name);
+    if (!out_file)
+        ERROR("Can't open file " + file_name);
+    prologue.writeTo(out_file);
+    spool->copyTo(out_file, stmts_num * func_idx / func_num,
+                  stmts_num * (func_idx + 1) / func_num);
+    epilogue.writeTo(out_file);
+    if (!out_file)
+        ERROR("Can't write to file " + file_name);
+}
+
+StmtSpool::StmtSpool(std::string _file_name)
+    : file_name(std::move(_file_name)), offsets(1, 0) {
+    file.open(file_name, std::ios::in | std::ios::out | std::ios::trunc |
+                             std::ios::binary);
+    if (!file)
+        ERROR("Can't open file " + file_name);
+}
+
+StmtSpool::~StmtSpool() {
+    file.close();
+    std::remove(file_name.c_str());
+}
+
+void StmtSpool::append(const SourceWriter &stmt) {
+    file.write(stmt.str().data(), stmt.size());
+    if (!file)
+        ERROR("Can't write to file " + file_name);
+    offsets.push_back(offsets.back() + stmt.size());
+}
+
+void StmtSpool::copyTo(std::ostream &stream, size_t first, size_t last) {
+    static const size_t BUFFER_SIZE = 1 << 16;
+    std::vector<char> buffer(BUFFER_SIZE);
+    file.flush();
+    file.seekg(offsets.at(first));
+    uint64_t left = offsets.at(last) - offsets.at(first);
+    while (left != 0 && file) {
+        auto size = static_cast<std::streamsize>(
+            std::min<uint64_t>(left, BUFFER_SIZE));
+        file.read(buffer.data(), size);
+        stream.write(buffer.data(), size);
+        left -= size;
+    }
+    if (!file)
+        ERROR("Can't read from file " + file_name);
 }
@@ -18,27 +18,73 @@ limitations under the License.
 
 #include "stmt.h"
 
+#include <cstdint>
+#include <fstream>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace yarpgen {
 
+// Emitted top-level statements of the test. With --stream-emit we keep them in
+// a file until the rest of the test is emitted, so the IR of every statement
+// can be released right after its population.
+class StmtSpool {
+  public:
+    explicit StmtSpool(std::string _file_name);
+    ~StmtSpool();
+    StmtSpool(const StmtSpool &) = delete;
+    StmtSpool &operator=(const StmtSpool &) = delete;
+
+    void append(const SourceWriter &stmt);
+    size_t getStmtsNum() { return offsets.size() - 1; }
+    // Copies the statements with indices in [first, last) to the stream
+    void copyTo(std::ostream &stream, size_t first, size_t last);
+
+  private:
+    std::string file_name;
+    std::fstream file;
+    // Offset of every statement in the file and the size of the file
+    std::vector<uint64_t> offsets;
+};
+
 class ProgramGenerator {
   public:
     ProgramGenerator();
     void emit();
 
   private:
-    void emitCheckFunc(std::ostream &stream);
-    void emitDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream);
-    void emitInit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream);
-    void emitCheck(std::shared_ptr<EmitCtx> ctx, std::ostream &stream);
-    void emitExtDecl(std::shared_ptr<EmitCtx> ctx, std::ostream &stream);
-    void emitTest(std::shared_ptr<EmitCtx> ctx, std::ostream &stream);
-    void emitMain(std::shared_ptr<EmitCtx> ctx, std::ostream &stream);
+    // Makes all of the random decisions about the emission, so the emission
+    // itself is a deterministic read-only pass over the IR.
+    void prepareEmission();
+    // Populates the test and moves every top-level statement to the spool
+    void populateAndStream(std::shared_ptr<PopulateCtx> ctx);
+
+    void emitCheckFunc(SourceWriter &stream);
+    void emitBulkHashFunc(SourceWriter &stream);
+    void emitDecl(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream);
+    void emitInit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream);
+    void emitCheck(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream);
+    void emitExtDecl(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream);
+    void emitTest(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                  size_t func_idx);
+    // Everything before and after the body of the test function
+    void emitTestPrologue(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                          size_t func_idx);
+    void emitTestEpilogue(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream);
+    // Writes the test function with the body from the spool
+    void writeStreamedTest(const std::string &file_name,
+                           const SourceWriter &prologue,
+                           const SourceWriter &epilogue, size_t func_idx);
+    void emitMain(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream);
 
     std::shared_ptr<SymbolTable> ext_inp_sym_tbl;
     std::shared_ptr<SymbolTable> ext_out_sym_tbl;
     std::shared_ptr<ScopeStmt> new_test;
+    // The test split into consecutive parts, one part per test function
+    std::vector<std::shared_ptr<ScopeStmt>> test_parts;
+    // Statements of the test in the streaming mode (test_parts are empty)
+    std::shared_ptr<StmtSpool> spool;
 };
 
 } // namespace yarpgen
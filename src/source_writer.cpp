@@ -0,0 +1,121 @@
+/*
+Copyright (c) 2020, Intel Corporation
+Copyright (c) 2020, University of Utah
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+     http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//////////////////////////////////////////////////////////////////////////////
+
+#include "source_writer.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <fstream>
+
+using namespace yarpgen;
+
+// Indentation is a prefix of this string, so we never build it.
+// Deeper indentation is written in several steps.
+static const std::string indent_buffer(256, ' ');
+
+// Two-digit lookup table for integer formatting
+static const char digit_pairs[] = "00010203040506070809"
+                                  "10111213141516171819"
+                                  "20212223242526272829"
+                                  "30313233343536373839"
+                                  "40414243444546474849"
+                                  "50515253545556575859"
+                                  "60616263646566676869"
+                                  "70717273747576777879"
+                                  "80818283848586878889"
+                                  "90919293949596979899";
+
+SourceWriter::SourceWriter(size_t capacity) { buffer.reserve(capacity); }
+
+SourceWriter &SourceWriter::operator<<(Indent indent) {
+    size_t width = indent.getLevel() * INDENT_WIDTH;
+    while (width > 0) {
+        size_t chunk = std::min(width, indent_buffer.size());
+        buffer.append(indent_buffer, 0, chunk);
+        width -= chunk;
+    }
+    return *this;
+}
+
+SourceWriter &SourceWriter::writeUnsigned(uint64_t value) {
+    // 20 digits is enough for the biggest 64-bit number
+    char tmp[20];
+    char *end = tmp + sizeof(tmp);
+    char *pos = end;
+    while (value >= 100) {
+        size_t idx = (value % 100) * 2;
+        value /= 100;
+        *--pos = digit_pairs[idx + 1];
+        *--pos = digit_pairs[idx];
+    }
+    if (value >= 10) {
+        size_t idx = value * 2;
+        *--pos = digit_pairs[idx + 1];
+        *--pos = digit_pairs[idx];
+    }
+    else
+        *--pos = static_cast<char>('0' + value);
+    buffer.append(pos, end - pos);
+    return *this;
+}
+
+SourceWriter &SourceWriter::writeSigned(int64_t value) {
+    if (value >= 0)
+        return writeUnsigned(static_cast<uint64_t>(value));
+    buffer.push_back('-');
+    // Negation in unsigned arithmetic is well defined for INT64_MIN
+    return writeUnsigned(0 - static_cast<uint64_t>(value));
+}
+
+SourceWriter &SourceWriter::operator<<(IRValue val) {
+    switch (val.getIntTypeID()) {
+        case IntTypeID::BOOL:
+            return writeUnsigned(val.getValueRef<bool>());
+        case IntTypeID::SCHAR:
+            return writeSigned(val.getValueRef<int8_t>());
+        case IntTypeID::UCHAR:
+            return writeUnsigned(val.getValueRef<uint8_t>());
+        case IntTypeID::SHORT:
+            return writeSigned(val.getValueRef<int16_t>());
+        case IntTypeID::USHORT:
+            return writeUnsigned(val.getValueRef<uint16_t>());
+        case IntTypeID::INT:
+            return writeSigned(val.getValueRef<int32_t>());
+        case IntTypeID::UINT:
+            return writeUnsigned(val.getValueRef<uint32_t>());
+        case IntTypeID::LLONG:
+            return writeSigned(val.getValueRef<int64_t>());
+        case IntTypeID::ULLONG:
+            return writeUnsigned(val.getValueRef<uint64_t>());
+        case IntTypeID::MAX_INT_TYPE_ID:
+            ERROR("Bad IntTypeID");
+    }
+    return *this;
+}
+
+void SourceWriter::writeTo(std::ostream &stream) const {
+    stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+}
+
+void SourceWriter::writeToFile(const std::string &file_name) const {
+    std::ofstream out_file(file_name);
+    if (!out_file)
+        ERROR(std::string("Can't open file ") + file_name);
+    writeTo(out_file);
+    if (!out_file)
+        ERROR(std::string("Can't write to file ") + file_name);
+}
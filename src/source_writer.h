@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2020, Intel Corporation
+Copyright (c) 2020, University of Utah
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+     http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "ir_value.h"
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+namespace yarpgen {
+
+// Indentation level of the emitted code. We keep only the number of levels,
+// so nested emission doesn't need to build a new string for every call.
+class Indent {
+  public:
+    Indent() : level(0) {}
+    explicit Indent(size_t _level) : level(_level) {}
+
+    size_t getLevel() const { return level; }
+    Indent next() const { return Indent(level + 1); }
+
+  private:
+    size_t level;
+};
+
+// Output buffer for the generated source code. All of the emission goes to
+// a contiguous buffer and each file is written with a single call.
+// Unlike std::ostream, it doesn't depend on locale and formats integers
+// without any intermediate strings.
+class SourceWriter {
+  public:
+    // Most of the buffers hold a few kilobytes. The buffer grows as needed,
+    // and the callers that know the size in advance can reserve it.
+    static const size_t DEFAULT_CAPACITY = 1 << 12;
+    static const size_t INDENT_WIDTH = 4;
+
+    explicit SourceWriter(size_t capacity = DEFAULT_CAPACITY);
+
+    SourceWriter &operator<<(const std::string &str) {
+        buffer.append(str);
+        return *this;
+    }
+    SourceWriter &operator<<(const char *str) {
+        buffer.append(str);
+        return *this;
+    }
+    SourceWriter &operator<<(char c) {
+        buffer.push_back(c);
+        return *this;
+    }
+    SourceWriter &operator<<(const SourceWriter &other) {
+        buffer.append(other.buffer);
+        return *this;
+    }
+    SourceWriter &operator<<(Indent indent);
+    SourceWriter &operator<<(IRValue val);
+
+    SourceWriter &operator<<(int value) { return writeSigned(value); }
+    SourceWriter &operator<<(long value) { return writeSigned(value); }
+    SourceWriter &operator<<(long long value) { return writeSigned(value); }
+    SourceWriter &operator<<(unsigned value) { return writeUnsigned(value); }
+    SourceWriter &operator<<(unsigned long value) {
+        return writeUnsigned(value);
+    }
+    SourceWriter &operator<<(unsigned long long value) {
+        return writeUnsigned(value);
+    }
+
+    void write(const char *data, size_t size) { buffer.append(data, size); }
+    void reserve(size_t capacity) { buffer.reserve(capacity); }
+
+    const std::string &str() const { return buffer; }
+    size_t size() const { return buffer.size(); }
+    void clear() { buffer.clear(); }
+
+    // Copies the whole buffer to the stream
+    void writeTo(std::ostream &stream) const;
+    // Writes the whole buffer to the file with a single call
+    void writeToFile(const std::string &file_name) const;
+
+  private:
+    SourceWriter &writeSigned(int64_t value);
+    SourceWriter &writeUnsigned(uint64_t value);
+
+    std::string buffer;
+};
+
+} // namespace yarpgen
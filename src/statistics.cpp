@@ -16,5 +16,333 @@ limitations under the License.
 //////////////////////////////////////////////////////////////////////////////
 
 #include "statistics.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define YARPGEN_USE_RUSAGE
+#endif
 
 using namespace yarpgen;
+
+static const char *getPhaseName(GenPhase phase) {
+    switch (phase) {
+        case GenPhase::TOTAL:
+            return "total";
+        case GenPhase::GEN_STRUCTURE:
+            return "generate_structure";
+        case GenPhase::POPULATE:
+            return "populate";
+        case GenPhase::REBUILD:
+            return "rebuild";
+        case GenPhase::TYPE_INIT:
+            return "type_init";
+        case GenPhase::EMIT_EXT_DECL:
+            return "emit_ext_decl";
+        case GenPhase::EMIT_DECL:
+            return "emit_decl";
+        case GenPhase::EMIT_INIT:
+            return "emit_init";
+        case GenPhase::EMIT_CHECK:
+            return "emit_check";
+        case GenPhase::EMIT_MAIN:
+            return "emit_main";
+        case GenPhase::EMIT_TEST:
+            return "emit_test";
+        case GenPhase::WRITE:
+            return "write";
+        case GenPhase::MAX_GEN_PHASE:
+            ERROR("Bad generation phase");
+    }
+    return "";
+}
+
+static const char *getUBName(UBKind kind) {
+    switch (kind) {
+        case UBKind::NoUB:
+            return "no_ub";
+        case UBKind::Uninit:
+            return "uninit";
+        case UBKind::SignOvf:
+            return "sign_ovf";
+        case UBKind::SignOvfMin:
+            return "sign_ovf_min";
+        case UBKind::ZeroDiv:
+            return "zero_div";
+        case UBKind::ShiftRhsNeg:
+            return "shift_rhs_neg";
+        case UBKind::ShiftRhsLarge:
+            return "shift_rhs_large";
+        case UBKind::NegShift:
+            return "neg_shift";
+        case UBKind::NoMemeber:
+            return "no_member";
+        case UBKind::OutOfBounds:
+            return "out_of_bounds";
+        case UBKind::MaxUB:
+            ERROR("Bad UB kind");
+    }
+    return "";
+}
+
+static const char *getBinaryOpName(BinaryOp op) {
+    switch (op) {
+        case BinaryOp::ADD:
+            return "add";
+        case BinaryOp::SUB:
+            return "sub";
+        case BinaryOp::MUL:
+            return "mul";
+        case BinaryOp::DIV:
+            return "div";
+        case BinaryOp::MOD:
+            return "mod";
+        case BinaryOp::LT:
+            return "lt";
+        case BinaryOp::GT:
+            return "gt";
+        case BinaryOp::LE:
+            return "le";
+        case BinaryOp::GE:
+            return "ge";
+        case BinaryOp::EQ:
+            return "eq";
+        case BinaryOp::NE:
+            return "ne";
+        case BinaryOp::LOG_AND:
+            return "log_and";
+        case BinaryOp::LOG_OR:
+            return "log_or";
+        case BinaryOp::BIT_AND:
+            return "bit_and";
+        case BinaryOp::BIT_OR:
+            return "bit_or";
+        case BinaryOp::BIT_XOR:
+            return "bit_xor";
+        case BinaryOp::SHL:
+            return "shl";
+        case BinaryOp::SHR:
+            return "shr";
+        case BinaryOp::MAX_BIN_OP:
+            ERROR("Bad binary operator");
+    }
+    return "";
+}
+
+static const char *getUnaryOpName(UnaryOp op) {
+    switch (op) {
+        case UnaryOp::PLUS:
+            return "plus";
+        case UnaryOp::NEGATE:
+            return "negate";
+        case UnaryOp::LOG_NOT:
+            return "log_not";
+        case UnaryOp::BIT_NOT:
+            return "bit_not";
+        case UnaryOp::MAX_UN_OP:
+            ERROR("Bad unary operator");
+    }
+    return "";
+}
+
+static const char *getMemKindName(MemKind kind) {
+    switch (kind) {
+        case MemKind::CONST_EXPR:
+            return "const_expr";
+        case MemKind::SCALAR_VAR_USE_EXPR:
+            return "scalar_var_use_expr";
+        case MemKind::ARRAY_USE_EXPR:
+            return "array_use_expr";
+        case MemKind::ITER_USE_EXPR:
+            return "iter_use_expr";
+        case MemKind::TYPE_CAST_EXPR:
+            return "type_cast_expr";
+        case MemKind::UNARY_EXPR:
+            return "unary_expr";
+        case MemKind::BINARY_EXPR:
+            return "binary_expr";
+        case MemKind::TERNARY_EXPR:
+            return "ternary_expr";
+        case MemKind::SUBSCRIPT_EXPR:
+            return "subscript_expr";
+        case MemKind::ASSIGN_EXPR:
+            return "assign_expr";
+        case MemKind::CALL_EXPR:
+            return "call_expr";
+        case MemKind::EXPR_STMT:
+            return "expr_stmt";
+        case MemKind::DECL_STMT:
+            return "decl_stmt";
+        case MemKind::STMT_BLOCK:
+            return "stmt_block";
+        case MemKind::LOOP_SEQ_STMT:
+            return "loop_seq_stmt";
+        case MemKind::LOOP_NEST_STMT:
+            return "loop_nest_stmt";
+        case MemKind::IF_ELSE_STMT:
+            return "if_else_stmt";
+        case MemKind::STUB_STMT:
+            return "stub_stmt";
+        case MemKind::SCALAR_VAR:
+            return "scalar_var";
+        case MemKind::ARRAY:
+            return "array";
+        case MemKind::ITERATOR:
+            return "iterator";
+        case MemKind::INTEGRAL_TYPE:
+            return "integral_type";
+        case MemKind::ARRAY_TYPE:
+            return "array_type";
+        case MemKind::POPULATE_CTX:
+            return "populate_ctx";
+        case MemKind::EMIT_CTX:
+            return "emit_ctx";
+        case MemKind::SYMBOL_TABLE:
+            return "symbol_table";
+        case MemKind::MAX_MEM_KIND:
+            ERROR("Bad memory kind");
+    }
+    return "";
+}
+
+// Returns the peak resident set size of the process in bytes (or 0 if we
+// can't get it)
+static uint64_t getPeakRSS() {
+#ifdef YARPGEN_USE_RUSAGE
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    // Linux reports it in kilobytes
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+void Statistics::setDeadline(uint64_t msec) {
+    // A quarter of the budget is left for everything that comes after the
+    // deadline. Emission is usually much faster than the population, so it
+    // is enough.
+    use_deadline = msec != 0;
+    deadline_hit = false;
+    deadline = std::chrono::steady_clock::now() +
+               std::chrono::microseconds(msec * 750);
+}
+
+size_t Statistics::shrinkForMemBudget(size_t limit) {
+    if (mem_budget == 0)
+        return limit;
+    uint64_t used = all_bytes_live;
+    if (used * 2 <= mem_budget)
+        return limit;
+    mem_budget_hit = true;
+    if (used >= mem_budget)
+        return std::min<size_t>(limit, 1);
+    uint64_t new_limit = limit * (mem_budget - used) * 2 / mem_budget;
+    return std::max<size_t>(new_limit, std::min<size_t>(limit, 1));
+}
+
+void Statistics::writeMemReport(std::ostream &stream) {
+    stream << std::left << std::setw(24) << "object" << std::right
+           << std::setw(12) << "live" << std::setw(12) << "peak"
+           << std::setw(12) << "total" << std::setw(16) << "peak bytes"
+           << "\n";
+    for (size_t i = 0; i < MEM_KINDS_NUM; ++i)
+        stream << std::left << std::setw(24)
+               << getMemKindName(static_cast<MemKind>(i)) << std::right
+               << std::setw(12) << obj_live.at(i).load() << std::setw(12)
+               << obj_peak.at(i).load() << std::setw(12)
+               << obj_total.at(i).load() << std::setw(16)
+               << bytes_peak.at(i).load() << "\n";
+    stream << "Peak of tracked objects: " << all_bytes_peak.load()
+           << " bytes\n";
+    stream << "Peak RSS: " << getPeakRSS() << " bytes\n";
+}
+
+// Writes the counters as a JSON object with the names as keys
+template <typename T, size_t N, typename NameFunc>
+static void writeJsonCounters(std::ostream &stream,
+                              const std::array<size_t, N> &counters,
+                              NameFunc get_name, size_t first = 0) {
+    stream << "{";
+    for (size_t i = first; i < N; ++i)
+        stream << (i != first ? ", " : "") << "\""
+               << get_name(static_cast<T>(i)) << "\": " << counters.at(i);
+    stream << "}";
+}
+
+void Statistics::writeJson(const std::string &file_name, size_t seed) {
+    std::ofstream out_file(file_name);
+    if (!out_file)
+        ERROR("Can't open file " + file_name);
+
+    out_file << "{\n";
+    out_file << "  \"seed\": " << seed << ",\n";
+    out_file << "  \"stmt_num\": " << stmt_num << ",\n";
+    out_file << "  \"expr_num\": " << expr_num << ",\n";
+    out_file << "  \"compile_cost\": " << compile_cost << ",\n";
+    out_file << "  \"dyn_ops_num\": " << dyn_ops_num << ",\n";
+    out_file << "  \"deadline_hit\": " << (deadline_hit ? "true" : "false")
+             << ",\n";
+    out_file << "  \"mem_budget_hit\": "
+             << (mem_budget_hit ? "true" : "false") << ",\n";
+
+    // NoUB is never counted, so we skip it
+    out_file << "  \"ub\": ";
+    writeJsonCounters<UBKind>(out_file, ub_num, getUBName, 1);
+    out_file << ",\n";
+    out_file << "  \"rebuild\": {\n";
+    out_file << "    \"binary\": ";
+    writeJsonCounters<BinaryOp>(out_file, bin_rewrite_num, getBinaryOpName);
+    out_file << ",\n";
+    out_file << "    \"unary\": ";
+    writeJsonCounters<UnaryOp>(out_file, un_rewrite_num, getUnaryOpName);
+    out_file << ",\n";
+    out_file << "    \"type_cast\": " << cast_rewrite_num << ",\n";
+    out_file << "    \"subscript\": " << subs_rewrite_num << ",\n";
+    out_file << "    \"avoided_on_create\": " << avoided_ub_num << ",\n";
+    out_file << "    \"reevaluations\": " << reeval_num << "\n";
+    out_file << "  },\n";
+
+    if (mem_tracking_enabled) {
+        out_file << "  \"memory\": {\n";
+        out_file << "    \"peak_rss\": " << getPeakRSS() << ",\n";
+        out_file << "    \"tracked_bytes_peak\": " << all_bytes_peak.load()
+                 << ",\n";
+        out_file << "    \"objects\": {\n";
+        for (size_t i = 0; i < MEM_KINDS_NUM; ++i)
+            out_file << "      \"" << getMemKindName(static_cast<MemKind>(i))
+                     << "\": {\"live\": " << obj_live.at(i).load()
+                     << ", \"peak\": " << obj_peak.at(i).load()
+                     << ", \"total\": " << obj_total.at(i).load()
+                     << ", \"peak_bytes\": " << bytes_peak.at(i).load() << "}"
+                     << (i + 1 < MEM_KINDS_NUM ? ",\n" : "\n");
+        out_file << "    }\n";
+        out_file << "  },\n";
+    }
+
+    // Time is reported in milliseconds. Phases that run on several threads
+    // report the sum over the threads.
+    out_file << "  \"phases\": {\n";
+    out_file << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < PHASES_NUM; ++i) {
+        out_file << "    \"" << getPhaseName(static_cast<GenPhase>(i))
+                 << "\": {\"time_ms\": "
+                 << static_cast<double>(phase_time.at(i).load()) / 1e6
+                 << ", \"calls\": " << phase_calls.at(i).load() << "}"
+                 << (i + 1 < PHASES_NUM ? ",\n" : "\n");
+    }
+    out_file << "  }\n";
+    out_file << "}\n";
+
+    if (!out_file)
+        ERROR("Can't write to file " + file_name);
+}
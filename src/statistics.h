@@ -18,7 +18,12 @@ limitations under the License.
 
 #include "enums.h"
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <ostream>
+#include <string>
 
 namespace yarpgen {
 class Statistics {
@@ -35,12 +40,196 @@ class Statistics {
 
     void addUB(UBKind kind) { ub_num.at(static_cast<size_t>(kind))++; }
 
+    // Rewrites of the expression trees that eliminate UB
+    void addBinaryRewrite(BinaryOp op) {
+        bin_rewrite_num.at(static_cast<size_t>(op))++;
+    }
+    void addUnaryRewrite(UnaryOp op) {
+        un_rewrite_num.at(static_cast<size_t>(op))++;
+    }
+    void addCastRewrite() { cast_rewrite_num++; }
+    void addSubscriptRewrite() { subs_rewrite_num++; }
+    // UB that create() avoided by picking another operator
+    void addAvoidedUB() { avoided_ub_num++; }
+    // Evaluation of a rewritten tree that checks if the UB is gone
+    void addReevaluation() { reeval_num++; }
+
+    void addDynOps(uint64_t val) { dyn_ops_num += val; }
+    uint64_t getDynOpsNum() { return dyn_ops_num; }
+
+    void addExpr(uint64_t cost) {
+        expr_num++;
+        compile_cost += cost;
+    }
+    size_t getExprNum() { return expr_num; }
+    uint64_t getCompileCost() { return compile_cost; }
+
+    // Generation deadline (see --deadline-ms). We report that it has passed
+    // a bit earlier, so the rest of the time is left to finish the started
+    // nodes and to emit the test.
+    void setDeadline(uint64_t msec);
+    bool pastDeadline() {
+        if (!use_deadline || deadline_hit)
+            return deadline_hit;
+        deadline_hit = std::chrono::steady_clock::now() >= deadline;
+        return deadline_hit;
+    }
+
+    // Timers are disabled by default, so they don't slow down the generation
+    void enableTimers() { timers_enabled = true; }
+    bool timersEnabled() { return timers_enabled; }
+    // Emission runs on several threads, so the timers are atomic
+    void addPhaseTime(GenPhase phase, uint64_t nsec) {
+        phase_time.at(static_cast<size_t>(phase)) += nsec;
+        phase_calls.at(static_cast<size_t>(phase))++;
+    }
+
+    // Memory accounting is disabled by default (see MemTracked)
+    void enableMemTracking() { mem_tracking_enabled = true; }
+    bool memTrackingEnabled() { return mem_tracking_enabled; }
+    void addObject(MemKind kind, size_t size) {
+        if (!mem_tracking_enabled)
+            return;
+        auto idx = static_cast<size_t>(kind);
+        obj_total.at(idx)++;
+        updatePeak(obj_peak.at(idx), ++obj_live.at(idx));
+        updatePeak(bytes_peak.at(idx), bytes_live.at(idx) += size);
+        updatePeak(all_bytes_peak, all_bytes_live += size);
+    }
+    void removeObject(MemKind kind, size_t size) {
+        if (!mem_tracking_enabled)
+            return;
+        auto idx = static_cast<size_t>(kind);
+        obj_live.at(idx)--;
+        bytes_live.at(idx) -= size;
+        all_bytes_live -= size;
+    }
+    // Soft memory limit (see --mem-budget). We don't control the allocator,
+    // so the budget covers only sizeof() of the tracked objects. It doesn't
+    // include the control blocks and the memory that the objects own, so it
+    // is several times smaller than RSS (1.5 MB vs 6.4 MB for seed 7).
+    void setMemBudget(uint64_t bytes) {
+        mem_budget = bytes;
+        enableMemTracking();
+    }
+    bool overMemBudget() {
+        if (mem_budget == 0 || all_bytes_live < mem_budget)
+            return false;
+        mem_budget_hit = true;
+        return true;
+    }
+    // Reduces the limit of the generation policy as the memory usage
+    // approaches the budget. The limit goes down linearly from its full
+    // value at a half of the budget to one when the budget is used up.
+    size_t shrinkForMemBudget(size_t limit);
+
+    // Prints a table with the memory statistics
+    void writeMemReport(std::ostream &stream);
+
+    // Writes all of the statistics to the file in JSON format
+    void writeJson(const std::string &file_name, size_t seed);
+
   private:
-    Statistics() : stmt_num(0), ub_num({}) {}
+    Statistics()
+        : stmt_num(0), dyn_ops_num(0), expr_num(0), compile_cost(0),
+          ub_num({}), bin_rewrite_num({}), un_rewrite_num({}),
+          cast_rewrite_num(0), subs_rewrite_num(0), avoided_ub_num(0),
+          reeval_num(0), use_deadline(false), deadline_hit(false), deadline(),
+          timers_enabled(false), phase_time(), phase_calls(),
+          mem_tracking_enabled(false), obj_live(), obj_peak(), obj_total(),
+          bytes_live(), bytes_peak(), all_bytes_live(0), all_bytes_peak(0),
+          mem_budget(0), mem_budget_hit(false) {}
+
+    static void updatePeak(std::atomic<uint64_t> &peak, uint64_t val) {
+        uint64_t old_peak = peak.load();
+        while (val > old_peak && !peak.compare_exchange_weak(old_peak, val))
+            ;
+    }
 
     size_t stmt_num;
-    // TODO: count undefined behavior stats
+    // Estimated number of statements that the test executes. Loops that we
+    // haven't populated yet are counted as if they had a single iteration.
+    uint64_t dyn_ops_num;
+    // Number of the expression nodes that we created and their total cost.
+    // Optimizers spend most of their time on loop nests, so every node costs
+    // one unit per enclosing loop (and one more for being there at all).
+    // Array references need dependence analysis, so they cost twice as much.
+    size_t expr_num;
+    uint64_t compile_cost;
+    // Detected UB, rebuild() counts it before the rewrite
     std::array<size_t, static_cast<size_t>(UBKind::MaxUB)> ub_num;
+    std::array<size_t, static_cast<size_t>(BinaryOp::MAX_BIN_OP)>
+        bin_rewrite_num;
+    std::array<size_t, static_cast<size_t>(UnaryOp::MAX_UN_OP)> un_rewrite_num;
+    size_t cast_rewrite_num;
+    size_t subs_rewrite_num;
+    size_t avoided_ub_num;
+    size_t reeval_num;
+
+    bool use_deadline;
+    bool deadline_hit;
+    std::chrono::steady_clock::time_point deadline;
+
+    static const size_t PHASES_NUM =
+        static_cast<size_t>(GenPhase::MAX_GEN_PHASE);
+    bool timers_enabled;
+    // Total time (in nanoseconds) and number of calls for every phase
+    std::array<std::atomic<uint64_t>, PHASES_NUM> phase_time;
+    std::array<std::atomic<uint64_t>, PHASES_NUM> phase_calls;
+
+    // Objects can be created on several threads during the emission, so the
+    // counters are atomic. Sizes don't include the shared_ptr control blocks
+    // and the memory that the objects own (e.g., vectors).
+    static const size_t MEM_KINDS_NUM =
+        static_cast<size_t>(MemKind::MAX_MEM_KIND);
+    bool mem_tracking_enabled;
+    std::array<std::atomic<uint64_t>, MEM_KINDS_NUM> obj_live;
+    std::array<std::atomic<uint64_t>, MEM_KINDS_NUM> obj_peak;
+    std::array<std::atomic<uint64_t>, MEM_KINDS_NUM> obj_total;
+    std::array<std::atomic<uint64_t>, MEM_KINDS_NUM> bytes_live;
+    std::array<std::atomic<uint64_t>, MEM_KINDS_NUM> bytes_peak;
+    std::atomic<uint64_t> all_bytes_live;
+    std::atomic<uint64_t> all_bytes_peak;
+
+    // In bytes, 0 means no limit
+    uint64_t mem_budget;
+    bool mem_budget_hit;
+};
+
+// Base class for the objects that we count in the memory report. It doesn't
+// have any data members, so it doesn't change the size of the objects.
+// Statistics is trivially destructible, so the objects with static storage
+// duration (e.g., interned types) can still access it during the exit.
+template <typename T, MemKind kind> class MemTracked {
+  protected:
+    MemTracked() { Statistics::getInstance().addObject(kind, sizeof(T)); }
+    MemTracked(const MemTracked &) : MemTracked() {}
+    MemTracked &operator=(const MemTracked &) = default;
+    ~MemTracked() { Statistics::getInstance().removeObject(kind, sizeof(T)); }
+};
+
+// Adds the time between its construction and destruction to the phase
+class ScopedTimer {
+  public:
+    explicit ScopedTimer(GenPhase _phase)
+        : phase(_phase), enabled(Statistics::getInstance().timersEnabled()) {
+        if (enabled)
+            start = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() {
+        if (!enabled)
+            return;
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start);
+        Statistics::getInstance().addPhaseTime(phase, duration.count());
+    }
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+  private:
+    GenPhase phase;
+    bool enabled;
+    std::chrono::steady_clock::time_point start;
 };
 
 } // namespace yarpgen
@@ -20,17 +20,40 @@ limitations under the License.
 #include "stmt.h"
 #include "options.h"
 #include "statistics.h"
+#include "trace.h"
 
 #include <algorithm>
+#include <atomic>
+#include <thread>
 #include <utility>
 
 using namespace yarpgen;
 
-void ExprStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                    std::string offset) {
-    stream << offset;
-    expr->emit(ctx, stream);
-    stream << ";";
+void ExprStmt::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                    Indent offset) {
+    Options &options = Options::getInstance();
+    if (!options.useExprTemps()) {
+        stream << offset;
+        expr->emit(ctx, stream);
+        stream << ";";
+        return;
+    }
+
+    // Names of the temporaries are unique only within the statement, so we
+    // put the statement into its own scope
+    static const size_t BUF_CAPACITY = 1 << 10;
+    SourceWriter temps(BUF_CAPACITY);
+    SourceWriter body(BUF_CAPACITY);
+    ctx->setExprTemps(&temps, offset.next());
+    expr->emit(ctx, body);
+    ctx->setExprTemps(nullptr, Indent());
+    if (temps.size() == 0) {
+        stream << offset << body << ";";
+        return;
+    }
+    stream << offset << "{\n"
+           << temps << offset.next() << body << ";\n"
+           << offset << "}";
 }
 
 std::shared_ptr<ExprStmt> ExprStmt::create(std::shared_ptr<PopulateCtx> ctx) {
@@ -40,8 +63,8 @@ std::shared_ptr<ExprStmt> ExprStmt::create(std::shared_ptr<PopulateCtx> ctx) {
     return std::make_shared<ExprStmt>(expr);
 }
 
-void DeclStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                    std::string offset) {
+void DeclStmt::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                    Indent offset) {
     stream << offset;
     // TODO: we need to do the right thing here
     stream << data->getType()->getName(ctx) << " ";
@@ -53,26 +76,35 @@ void DeclStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
     stream << ";";
 }
 
-void StmtBlock::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                     std::string offset) {
-    for (const auto &stmt : stmts) {
-        stmt->emit(ctx, stream, offset);
-        // TODO: will that work if we have suffix?
-        if (stmt->getKind() != IRNodeKind::LOOP_SEQ &&
-            stmt->getKind() != IRNodeKind::LOOP_NEST)
-            stream << "\n";
-    }
+void StmtBlock::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                     Indent offset) {
+    emitRange(std::move(ctx), stream, offset, 0, stmts.size());
+}
+
+void StmtBlock::emitRange(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                          Indent offset, size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i)
+        emitStmt(ctx, stream, offset, stmts[i]);
+}
+void StmtBlock::emitStmt(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                         Indent offset, const std::shared_ptr<Stmt> &stmt) {
+    stmt->emit(std::move(ctx), stream, offset);
+    // TODO: will that work if we have suffix?
+    if (stmt->getKind() != IRNodeKind::LOOP_SEQ &&
+        stmt->getKind() != IRNodeKind::LOOP_NEST)
+        stream << "\n";
 }
 
 std::shared_ptr<StmtBlock>
 StmtBlock::generateStructure(std::shared_ptr<GenCtx> ctx) {
+    ScopedTraceEvent trace("generateStructure", IRNodeKind::BLOCK);
     std::vector<std::shared_ptr<Stmt>> stmts;
 
     auto gen_policy = ctx->getGenPolicy();
     size_t stmt_num = rand_val_gen->getRandId(gen_policy->scope_stmt_num_distr);
-    stmts.reserve(stmt_num);
-
     Statistics &stats = Statistics::getInstance();
+    stmt_num = stats.shrinkForMemBudget(stmt_num);
+    stmts.reserve(stmt_num);
 
     std::shared_ptr<Stmt> new_stmt;
     for (size_t i = 0; i < stmt_num; ++i) {
@@ -90,6 +122,9 @@ StmtBlock::generateStructure(std::shared_ptr<GenCtx> ctx) {
         // stmt)
         fallback |= stmt_kind == IRNodeKind::LOOP_NEST &&
                     (stats.getStmtNum() + 3 >= gen_policy->stmt_num_lim);
+        // We are close to the deadline (or out of memory budget), so we
+        // don't expand the test anymore
+        fallback |= stats.pastDeadline() || stats.overMemBudget();
         if (fallback)
             break;
 
@@ -113,35 +148,117 @@ StmtBlock::generateStructure(std::shared_ptr<GenCtx> ctx) {
     return std::make_shared<StmtBlock>(stmts);
 }
 
-void StmtBlock::populate(std::shared_ptr<PopulateCtx> ctx) {
+size_t StmtBlock::countStmts() {
+    size_t ret = 0;
+    for (const auto &stmt : stmts)
+        ret += stmt->countStmts();
+    return ret;
+}
+
+std::shared_ptr<Stmt>
+StmtBlock::populateStmt(std::shared_ptr<PopulateCtx> ctx,
+                        std::shared_ptr<Stmt> stmt) {
     auto gen_pol = ctx->getGenPolicy();
+    Options &options = Options::getInstance();
+    Statistics &stats = Statistics::getInstance();
+
+    if (stmt->getKind() != IRNodeKind::STUB) {
+        stmt->populate(ctx);
+        return stmt;
+    }
+
+    // We are out of the compile cost or memory budget (or close to the
+    // deadline), so the rest of the new statements are dropped. Loops and
+    // branches stay in place.
+    if ((options.useCompileCostBudget() &&
+         stats.getCompileCost() >= options.getMaxCompileCost()) ||
+        stats.pastDeadline() || stats.overMemBudget())
+        return nullptr;
+
+    std::shared_ptr<Stmt> new_stmt;
+    IRNodeKind new_stmt_kind =
+        rand_val_gen->getRandId(gen_pol->stmt_kind_pop_distr);
+    if (new_stmt_kind == IRNodeKind::ASSIGN) {
+        new_stmt = ExprStmt::create(ctx);
+    }
+    else
+        ERROR("Bad IRNode kind drawing");
+    return new_stmt;
+}
+
+void StmtBlock::populate(std::shared_ptr<PopulateCtx> ctx) {
+    ScopedTraceEvent trace("populate", IRNodeKind::BLOCK);
+    for (auto &stmt : stmts)
+        stmt = populateStmt(ctx, std::move(stmt));
+    stmts.erase(std::remove(stmts.begin(), stmts.end(), nullptr),
+                stmts.end());
+}
 
+void StmtBlock::populateAndRelease(
+    std::shared_ptr<PopulateCtx> ctx,
+    const std::function<void(std::shared_ptr<Stmt>)> &consume) {
+    ScopedTraceEvent trace("populate", IRNodeKind::BLOCK);
     for (auto &stmt : stmts) {
-        if (stmt->getKind() != IRNodeKind::STUB)
-            stmt->populate(ctx);
-        else {
-            std::shared_ptr<Stmt> new_stmt;
-            IRNodeKind new_stmt_kind =
-                rand_val_gen->getRandId(gen_pol->stmt_kind_pop_distr);
-            if (new_stmt_kind == IRNodeKind::ASSIGN) {
-                new_stmt = ExprStmt::create(ctx);
-            }
-            else
-                ERROR("Bad IRNode kind drawing");
-            stmt = new_stmt;
-        }
+        auto new_stmt = populateStmt(ctx, std::move(stmt));
+        stmt = nullptr;
+        if (new_stmt)
+            consume(std::move(new_stmt));
     }
+    stmts.clear();
 }
 
-void ScopeStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                     std::string offset) {
+void ScopeStmt::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                     Indent offset) {
+    stream << offset << "{\n";
+    StmtBlock::emit(ctx, stream, offset.next());
+    stream << offset << "}\n";
+}
+
+void ScopeStmt::emitParallel(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                             Indent offset, size_t threads_num) {
+    // Statements differ a lot in size, so we split the scope into more chunks
+    // than we have threads and let the threads take them one by one
+    static const size_t CHUNKS_PER_THREAD = 4;
+    size_t chunks_num = std::min(stmts.size(), threads_num * CHUNKS_PER_THREAD);
+    if (threads_num <= 1 || chunks_num <= 1) {
+        emit(std::move(ctx), stream, offset);
+        return;
+    }
+
+    std::vector<SourceWriter> chunks(chunks_num);
+
+    std::atomic<size_t> next_chunk(0);
+    auto emit_chunks = [&]() {
+        // The context is mutable, so every thread needs its own copy
+        auto thread_ctx = std::make_shared<EmitCtx>(*ctx);
+        for (size_t i = next_chunk++; i < chunks_num; i = next_chunk++) {
+            size_t first = stmts.size() * i / chunks_num;
+            size_t last = stmts.size() * (i + 1) / chunks_num;
+            emitRange(thread_ctx, chunks[i], offset.next(), first, last);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(threads_num - 1);
+    for (size_t i = 1; i < threads_num; ++i)
+        threads.emplace_back(emit_chunks);
+    emit_chunks();
+    for (auto &thread : threads)
+        thread.join();
+
+    size_t size = 0;
+    for (const auto &chunk : chunks)
+        size += chunk.size();
+    stream.reserve(stream.size() + size + 64);
     stream << offset << "{\n";
-    StmtBlock::emit(ctx, stream, offset + "    ");
+    for (const auto &chunk : chunks)
+        stream << chunk;
     stream << offset << "}\n";
 }
 
 std::shared_ptr<ScopeStmt>
 ScopeStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
+    ScopedTraceEvent trace("generateStructure", IRNodeKind::SCOPE);
     // TODO: will that work?
     auto new_scope = std::make_shared<ScopeStmt>();
     auto stmt_block = StmtBlock::generateStructure(std::move(ctx));
@@ -149,14 +266,14 @@ ScopeStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
     return new_scope;
 }
 
-void LoopHead::emitPrefix(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                          std::string offset) {
+void LoopHead::emitPrefix(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                          Indent offset) {
     if (prefix.use_count() != 0)
-        prefix->emit(ctx, stream, std::move(offset));
+        prefix->emit(ctx, stream, offset);
 }
 
-void LoopHead::emitHeader(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                          std::string offset) {
+void LoopHead::emitHeader(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                          Indent offset) {
     if (!pragmas.empty()) {
         for (auto &pragma : pragmas) {
             pragma->emit(ctx, stream, offset);
@@ -172,14 +289,7 @@ void LoopHead::emitHeader(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
 
     Options &options = Options::getInstance();
 
-    auto emit_iter_param_val = [&stream, &options](std::shared_ptr<Expr> expr) {
-        EvalCtx eval_ctx;
-        // TODO: do we want to recalculate it every time?
-        auto eval_res = expr->evaluate(eval_ctx);
-        assert(eval_res->isScalarVar() &&
-               "Iterator should have a scalar value");
-        auto scalar_eval_res = std::static_pointer_cast<ScalarVar>(eval_res);
-        IRValue val = scalar_eval_res->getCurrentValue();
+    auto emit_iter_param_val = [&stream, &options](IRValue val) {
         if (!options.getExplLoopParams())
             stream << "/*";
         stream << val;
@@ -196,7 +306,7 @@ void LoopHead::emitHeader(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
             auto start = (*iter)->getStart();
             if (!options.getExplLoopParams())
                 start->emit(ctx, stream);
-            emit_iter_param_val(start);
+            emit_iter_param_val((*iter)->getStartValue());
             stream << place_sep(iter, ", ");
         }
         stream << "; ";
@@ -204,9 +314,19 @@ void LoopHead::emitHeader(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
         for (auto iter = iters.begin(); iter != iters.end(); ++iter) {
             stream << (*iter)->getName(ctx) << " < ";
             auto end = (*iter)->getEnd();
-            if (!options.getExplLoopParams())
+            // Compact emission omits the outer parentheses of the
+            // expressions, but the end can bind weaker than the comparison
+            bool end_parens = options.getCompactEmit() &&
+                              (end->getKind() == IRNodeKind::BINARY ||
+                               end->getKind() == IRNodeKind::TERNARY);
+            if (!options.getExplLoopParams()) {
+                if (end_parens)
+                    stream << "(";
                 end->emit(ctx, stream);
-            emit_iter_param_val(end);
+                if (end_parens)
+                    stream << ")";
+            }
+            emit_iter_param_val((*iter)->getEndValue());
             stream << place_sep(iter, ", ");
         }
         stream << "; ";
@@ -216,7 +336,7 @@ void LoopHead::emitHeader(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
             auto step = (*iter)->getStep();
             if (!options.getExplLoopParams())
                 step->emit(ctx, stream);
-            emit_iter_param_val(step);
+            emit_iter_param_val((*iter)->getStepValue());
             stream << place_sep(iter, ", ");
         }
         stream << ") ";
@@ -229,12 +349,12 @@ void LoopHead::emitHeader(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
             auto start = (*iter)->getStart();
             if (!options.getExplLoopParams())
                 start->emit(ctx, stream);
-            emit_iter_param_val(start);
+            emit_iter_param_val((*iter)->getStartValue());
             stream << ")...(";
             auto end = (*iter)->getEnd();
             if (!options.getExplLoopParams())
                 end->emit(ctx, stream);
-            emit_iter_param_val(end);
+            emit_iter_param_val((*iter)->getEndValue());
             stream << ")";
             stream << place_sep(iter, ", ");
         }
@@ -243,10 +363,10 @@ void LoopHead::emitHeader(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
     }
 }
 
-void LoopHead::emitSuffix(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                          std::string offset) {
+void LoopHead::emitSuffix(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                          Indent offset) {
     if (suffix.use_count() != 0)
-        suffix->emit(ctx, stream, std::move(offset));
+        suffix->emit(ctx, stream, offset);
 }
 
 void LoopHead::createPragmas(std::shared_ptr<PopulateCtx> ctx) {
@@ -270,9 +390,38 @@ bool LoopHead::hasSIMDPragma() {
            pragmas.end();
 }
 
+// Every iteration of a loop executes body_cost statements and the loop itself
+// runs once per iteration of the enclosing loops. We limit the trip count, so
+// the estimated number of executed statements stays within the budget. Inner
+// loops are still counted with a single iteration at this point, so they get
+// whatever is left of the budget.
+static size_t limitTripCount(std::shared_ptr<PopulateCtx> ctx,
+                             size_t trip_count, size_t body_cost) {
+    uint64_t outer_iters = 1;
+    for (auto dim : ctx->getDimensions())
+        outer_iters *= dim;
+    uint64_t iter_cost = outer_iters * body_cost;
+
+    Options &options = Options::getInstance();
+    Statistics &stats = Statistics::getInstance();
+    if (options.useDynOpsBudget()) {
+        uint64_t budget = options.getMaxDynOps();
+        uint64_t used = stats.getDynOpsNum();
+        uint64_t spare = budget > used ? budget - used : 0;
+        trip_count =
+            std::min(trip_count, static_cast<size_t>(1 + spare / iter_cost));
+    }
+    // The first iteration is already counted
+    stats.addDynOps(iter_cost * (trip_count - 1));
+    return trip_count;
+}
+
 void LoopHead::populateArrays(std::shared_ptr<PopulateCtx> ctx) {
     auto gen_pol = ctx->getGenPolicy();
     size_t new_arrays_num = rand_val_gen->getRandId(gen_pol->new_arr_num_distr);
+    // Subscripts need at least one array for the loop, so we keep it
+    new_arrays_num =
+        Statistics::getInstance().shrinkForMemBudget(new_arrays_num);
     for (size_t i = 0; i < new_arrays_num; ++i) {
         ctx->getExtInpSymTable()->addArray(Array::create(ctx, true));
     }
@@ -290,8 +439,8 @@ void LoopHead::populateIterators(std::shared_ptr<PopulateCtx> ctx) {
     }
 }
 
-void LoopSeqStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                       std::string offset) {
+void LoopSeqStmt::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                       Indent offset) {
     stream << offset << "/* LoopSeq " << std::to_string(loops.size())
            << " */\n";
 
@@ -306,6 +455,7 @@ void LoopSeqStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
 
 std::shared_ptr<LoopSeqStmt>
 LoopSeqStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
+    ScopedTraceEvent trace("generateStructure", IRNodeKind::LOOP_SEQ);
     auto gen_pol = ctx->getGenPolicy();
     size_t loop_num = rand_val_gen->getRandId(gen_pol->loop_seq_num_distr);
 
@@ -341,6 +491,7 @@ LoopSeqStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
 }
 
 void LoopSeqStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
+    ScopedTraceEvent trace("populate", IRNodeKind::LOOP_SEQ);
     auto gen_pol = ctx->getGenPolicy();
 
     for (auto &loop : loops) {
@@ -356,6 +507,8 @@ void LoopSeqStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
 
         size_t new_dim = rand_val_gen->getRandValue(
             gen_pol->iters_end_limit_min, gen_pol->iter_end_limit_max);
+        new_dim =
+            limitTripCount(new_ctx, new_dim, 1 + loop.second->countStmts());
         new_ctx->addDimension(new_dim);
         loop_head->populateIterators(new_ctx);
         LoopHead::populateArrays(new_ctx);
@@ -382,31 +535,39 @@ void LoopSeqStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
     }
 }
 
-void LoopNestStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                        std::string offset) {
+size_t LoopSeqStmt::countStmts() {
+    size_t ret = 0;
+    for (const auto &loop : loops)
+        ret += 1 + loop.second->countStmts();
+    return ret;
+}
+
+void LoopNestStmt::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                        Indent offset) {
     stream << offset << "/* LoopNest " << std::to_string(loops.size())
            << " */\n";
 
-    std::string new_offset = offset;
+    size_t level = offset.getLevel();
     for (const auto &loop : loops) {
-        loop->emitPrefix(ctx, stream, new_offset);
-        loop->emitHeader(ctx, stream, new_offset);
-        stream << "\n" << new_offset << "{\n";
-        new_offset += "    ";
+        loop->emitPrefix(ctx, stream, Indent(level));
+        loop->emitHeader(ctx, stream, Indent(level));
+        stream << "\n" << Indent(level) << "{\n";
+        level++;
     }
 
-    body->emit(ctx, stream, new_offset);
-    new_offset.erase(new_offset.size() - 4, 4);
+    body->emit(ctx, stream, Indent(level));
+    level--;
 
     for (const auto &loop : loops) {
-        stream << new_offset << "} \n";
-        loop->emitSuffix(ctx, stream, new_offset);
-        new_offset.erase(new_offset.size() - 4, 4);
+        stream << Indent(level) << "} \n";
+        loop->emitSuffix(ctx, stream, Indent(level));
+        level--;
     }
 }
 
 std::shared_ptr<LoopNestStmt>
 LoopNestStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
+    ScopedTraceEvent trace("generateStructure", IRNodeKind::LOOP_NEST);
     auto gen_pol = ctx->getGenPolicy();
     size_t nest_depth = rand_val_gen->getRandId(gen_pol->loop_nest_depth_distr);
 
@@ -443,11 +604,13 @@ LoopNestStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
 }
 
 void LoopNestStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
+    ScopedTraceEvent trace("populate", IRNodeKind::LOOP_NEST);
     auto gen_pol = ctx->getGenPolicy();
     auto new_ctx = std::make_shared<PopulateCtx>(ctx);
     bool old_ctx_state = new_ctx->isTaken();
     std::vector<std::shared_ptr<LoopHead>>::iterator taken_switch_id;
     auto simd_switch_id = loops.end();
+    size_t body_cost = body->countStmts();
     for (auto i = loops.begin(); i != loops.end(); ++i) {
         if ((*i)->getPrefix().use_count() != 0) {
             (*i)->getPrefix()->populate(new_ctx);
@@ -462,6 +625,9 @@ void LoopNestStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
 
         size_t new_dim = rand_val_gen->getRandValue(
             gen_pol->iters_end_limit_min, gen_pol->iter_end_limit_max);
+        // Each loop of the nest repeats the inner loop headers and the body
+        size_t inner_cost = static_cast<size_t>(loops.end() - i) + body_cost;
+        new_dim = limitTripCount(new_ctx, new_dim, inner_cost);
         new_ctx->addDimension(new_dim);
         (*i)->populateIterators(new_ctx);
         LoopHead::populateArrays(new_ctx);
@@ -492,8 +658,12 @@ void LoopNestStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
     }
 }
 
-void IfElseStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                      std::string offset) {
+size_t LoopNestStmt::countStmts() {
+    return loops.size() + body->countStmts();
+}
+
+void IfElseStmt::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                      Indent offset) {
     stream << offset << "if (";
     // We can dump test structure before populating it
     if (cond.use_count() != 0)
@@ -508,6 +678,7 @@ void IfElseStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
 
 std::shared_ptr<IfElseStmt>
 IfElseStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
+    ScopedTraceEvent trace("generateStructure", IRNodeKind::IF_ELSE);
     auto gen_pol = ctx->getGenPolicy();
     auto new_ctx = std::make_shared<GenCtx>(*ctx);
     new_ctx->incIfElseDepth();
@@ -524,6 +695,7 @@ IfElseStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
 }
 
 void IfElseStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
+    ScopedTraceEvent trace("populate", IRNodeKind::IF_ELSE);
     cond = ArithmeticExpr::create(ctx);
 
     if (!cond->getValue()->isScalarVar()) {
@@ -557,19 +729,27 @@ void IfElseStmt::populate(std::shared_ptr<PopulateCtx> ctx) {
     }
 }
 
-void StubStmt::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                    std::string offset) {
+size_t IfElseStmt::countStmts() {
+    size_t ret = 1 + then_br->countStmts();
+    if (else_br.use_count() != 0)
+        ret += else_br->countStmts();
+    return ret;
+}
+
+void StubStmt::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                    Indent offset) {
     stream << offset << text;
 }
 
 std::shared_ptr<StubStmt>
 StubStmt::generateStructure(std::shared_ptr<GenCtx> ctx) {
+    ScopedTraceEvent trace("generateStructure", IRNodeKind::STUB);
     NameHandler &nh = NameHandler::getInstance();
     return std::make_shared<StubStmt>("Stub stmt #" + nh.getStubStmtIdx());
 }
 
-void Pragma::emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                  std::string offset) {
+void Pragma::emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                  Indent offset) {
     stream << offset << "#pragma ";
     auto clang_emit_helper = [&stream](std::string name) {
         stream << "clang loop " << name << "(enable)";
@@ -24,6 +24,7 @@ limitations under the License.
 #include "expr.h"
 #include "ir_node.h"
 
+#include <functional>
 #include <iostream>
 #include <memory>
 #include <utility>
@@ -33,38 +34,44 @@ namespace yarpgen {
 class Stmt : public IRNode {
   public:
     virtual IRNodeKind getKind() { return IRNodeKind::MAX_STMT_KIND; }
+    // Number of statements in the subtree (loop headers included). It doesn't
+    // depend on trip counts, so it is the cost of a single execution.
+    virtual size_t countStmts() { return 1; }
 };
 
-class ExprStmt : public Stmt {
+class ExprStmt : public Stmt,
+                 private MemTracked<ExprStmt, MemKind::EXPR_STMT> {
   public:
     explicit ExprStmt(std::shared_ptr<Expr> _expr) : expr(std::move(_expr)) {}
     IRNodeKind getKind() final { return IRNodeKind::EXPR; }
 
     std::shared_ptr<Expr> getExpr() { return expr; }
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
     static std::shared_ptr<ExprStmt> create(std::shared_ptr<PopulateCtx> ctx);
 
   private:
     std::shared_ptr<Expr> expr;
 };
 
-class DeclStmt : public Stmt {
+class DeclStmt : public Stmt,
+                 private MemTracked<DeclStmt, MemKind::DECL_STMT> {
   public:
     explicit DeclStmt(std::shared_ptr<Data> _data) : data(std::move(_data)) {}
     DeclStmt(std::shared_ptr<Data> _data, std::shared_ptr<Expr> _expr)
         : data(std::move(_data)), init_expr(std::move(_expr)) {}
     IRNodeKind getKind() final { return IRNodeKind::DECL; }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
 
   private:
     std::shared_ptr<Data> data;
     std::shared_ptr<Expr> init_expr;
 };
 
-class StmtBlock : public Stmt {
+class StmtBlock : public Stmt,
+                  private MemTracked<StmtBlock, MemKind::STMT_BLOCK> {
   public:
     StmtBlock() = default;
     explicit StmtBlock(std::vector<std::shared_ptr<Stmt>> _stmts)
@@ -76,22 +83,45 @@ class StmtBlock : public Stmt {
     }
 
     std::vector<std::shared_ptr<Stmt>> getStmts() { return stmts; }
+    size_t countStmts() override;
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") override;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) override;
     static std::shared_ptr<StmtBlock>
     generateStructure(std::shared_ptr<GenCtx> ctx);
     void populate(std::shared_ptr<PopulateCtx> ctx) override;
+    // Populates the statements one by one and passes each of them to the
+    // callback as soon as it is final. The block doesn't keep them, so their
+    // IR is released after the callback (unless it keeps them).
+    void populateAndRelease(
+        std::shared_ptr<PopulateCtx> ctx,
+        const std::function<void(std::shared_ptr<Stmt>)> &consume);
+
+    // Emits a single statement of a block
+    static void emitStmt(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                         Indent offset, const std::shared_ptr<Stmt> &stmt);
 
   protected:
+    // Emits statements with indices in [first, last)
+    void emitRange(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                   Indent offset, size_t first, size_t last);
+    // Returns the populated statement or nullptr if it was dropped
+    std::shared_ptr<Stmt> populateStmt(std::shared_ptr<PopulateCtx> ctx,
+                                       std::shared_ptr<Stmt> stmt);
+
     std::vector<std::shared_ptr<Stmt>> stmts;
 };
 
 class ScopeStmt : public StmtBlock {
   public:
     IRNodeKind getKind() final { return IRNodeKind::SCOPE; }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
+    // Emits the statements of the scope on several threads. Each thread
+    // writes its chunks to a separate buffer and the buffers are concatenated
+    // in order, so the result is the same as after emit().
+    void emitParallel(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                      Indent offset, size_t threads_num);
     static std::shared_ptr<ScopeStmt>
     generateStructure(std::shared_ptr<GenCtx> ctx);
 };
@@ -102,8 +132,8 @@ class Pragma {
   public:
     explicit Pragma(PragmaKind _kind) : kind(_kind) {}
     PragmaKind getKind() { return kind; }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "");
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent());
     static std::shared_ptr<Pragma> create(std::shared_ptr<PopulateCtx> ctx);
     static std::vector<std::shared_ptr<Pragma>>
     create(size_t num, std::shared_ptr<PopulateCtx> ctx);
@@ -126,12 +156,12 @@ class LoopHead {
     void addSuffix(std::shared_ptr<StmtBlock> _suffix) {
         suffix = std::move(_suffix);
     }
-    void emitPrefix(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                    std::string offset = "");
-    void emitHeader(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                    std::string offset = "");
-    void emitSuffix(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-                    std::string offset = "");
+    void emitPrefix(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                    Indent offset = Indent());
+    void emitHeader(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                    Indent offset = Indent());
+    void emitSuffix(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+                    Indent offset = Indent());
 
     void setIsForeach() { is_foreach = true; }
     bool isForeach() { return is_foreach; }
@@ -157,7 +187,8 @@ class LoopHead {
 
 // According to the agreement, a single standalone loop should be represented as
 // a LoopSeqStmt of size one
-class LoopSeqStmt : public LoopStmt {
+class LoopSeqStmt : public LoopStmt,
+                    private MemTracked<LoopSeqStmt, MemKind::LOOP_SEQ_STMT> {
   public:
     IRNodeKind getKind() final { return IRNodeKind::LOOP_SEQ; }
     void
@@ -165,11 +196,12 @@ class LoopSeqStmt : public LoopStmt {
                 _loop) {
         loops.push_back(std::move(_loop));
     }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
     static std::shared_ptr<LoopSeqStmt>
     generateStructure(std::shared_ptr<GenCtx> ctx);
     void populate(std::shared_ptr<PopulateCtx> ctx) override;
+    size_t countStmts() final;
 
   private:
     std::vector<
@@ -177,36 +209,40 @@ class LoopSeqStmt : public LoopStmt {
         loops;
 };
 
-class LoopNestStmt : public LoopStmt {
+class LoopNestStmt : public LoopStmt,
+                     private MemTracked<LoopNestStmt, MemKind::LOOP_NEST_STMT> {
   public:
     IRNodeKind getKind() final { return IRNodeKind::LOOP_NEST; }
     void addLoop(std::shared_ptr<LoopHead> _loop) {
         loops.push_back(std::move(_loop));
     }
     void addBody(std::shared_ptr<ScopeStmt> _body) { body = std::move(_body); }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
     static std::shared_ptr<LoopNestStmt>
     generateStructure(std::shared_ptr<GenCtx> ctx);
     void populate(std::shared_ptr<PopulateCtx> ctx) override;
+    size_t countStmts() final;
 
   private:
     std::vector<std::shared_ptr<LoopHead>> loops;
     std::shared_ptr<StmtBlock> body;
 };
 
-class IfElseStmt : public Stmt {
+class IfElseStmt : public Stmt,
+                   private MemTracked<IfElseStmt, MemKind::IF_ELSE_STMT> {
   public:
     IfElseStmt(std::shared_ptr<Expr> _cond, std::shared_ptr<ScopeStmt> _then_br,
                std::shared_ptr<ScopeStmt> _else_br)
         : cond(std::move(_cond)), then_br(std::move(_then_br)),
           else_br(std::move(_else_br)) {}
     IRNodeKind getKind() final { return IRNodeKind::IF_ELSE; }
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
     static std::shared_ptr<IfElseStmt>
     generateStructure(std::shared_ptr<GenCtx> ctx);
     void populate(std::shared_ptr<PopulateCtx> ctx) final;
+    size_t countStmts() final;
 
   private:
     std::shared_ptr<Expr> cond;
@@ -214,13 +250,14 @@ class IfElseStmt : public Stmt {
     std::shared_ptr<ScopeStmt> else_br;
 };
 
-class StubStmt : public Stmt {
+class StubStmt : public Stmt,
+                 private MemTracked<StubStmt, MemKind::STUB_STMT> {
   public:
     explicit StubStmt(std::string _text) : text(std::move(_text)) {}
     IRNodeKind getKind() final { return IRNodeKind::STUB; }
 
-    void emit(std::shared_ptr<EmitCtx> ctx, std::ostream &stream,
-              std::string offset = "") final;
+    void emit(std::shared_ptr<EmitCtx> ctx, SourceWriter &stream,
+              Indent offset = Indent()) final;
     static std::shared_ptr<StubStmt>
     generateStructure(std::shared_ptr<GenCtx> ctx);
 
@@ -0,0 +1,120 @@
+/*
+Copyright (c) 2020, Intel Corporation
+Copyright (c) 2020, University of Utah
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+     http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//////////////////////////////////////////////////////////////////////////////
+
+#include "trace.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+using namespace yarpgen;
+
+static const char *getNodeKindName(IRNodeKind kind) {
+    switch (kind) {
+        case IRNodeKind::CONST:
+            return "const";
+        case IRNodeKind::SCALAR_VAR_USE:
+            return "scalar_var_use";
+        case IRNodeKind::ITER_USE:
+            return "iter_use";
+        case IRNodeKind::ARRAY_USE:
+            return "array_use";
+        case IRNodeKind::SUBSCRIPT:
+            return "subscript";
+        case IRNodeKind::TYPE_CAST:
+            return "type_cast";
+        case IRNodeKind::ASSIGN:
+            return "assign";
+        case IRNodeKind::UNARY:
+            return "unary";
+        case IRNodeKind::BINARY:
+            return "binary";
+        case IRNodeKind::TERNARY:
+            return "ternary";
+        case IRNodeKind::CALL:
+            return "call";
+        case IRNodeKind::EXPR:
+            return "expr";
+        case IRNodeKind::DECL:
+            return "decl";
+        case IRNodeKind::BLOCK:
+            return "block";
+        case IRNodeKind::SCOPE:
+            return "scope";
+        case IRNodeKind::LOOP_SEQ:
+            return "loop_seq";
+        case IRNodeKind::LOOP_NEST:
+            return "loop_nest";
+        case IRNodeKind::IF_ELSE:
+            return "if_else";
+        case IRNodeKind::STUB:
+            return "stub";
+        case IRNodeKind::MAX_EXPR_KIND:
+        case IRNodeKind::MAX_STMT_KIND:
+            break;
+    }
+    return "unknown";
+}
+
+void Tracer::begin(const char *name) {
+    size_t depth = std::count_if(
+        open_events.begin(), open_events.end(),
+        [name](const char *open) { return std::strcmp(open, name) == 0; });
+    open_events.push_back(name);
+    auto time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    events.push_back({'B', name, IRNodeKind::MAX_STMT_KIND, depth,
+                      static_cast<uint64_t>(time.count())});
+}
+
+void Tracer::end(const char *name, IRNodeKind kind) {
+    open_events.pop_back();
+    auto time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    // The viewer merges the arguments of the begin and the end events. The
+    // kind of the node can be unknown at the beginning, so we put everything
+    // into the end event.
+    size_t depth = std::count_if(
+        open_events.begin(), open_events.end(),
+        [name](const char *open) { return std::strcmp(open, name) == 0; });
+    events.push_back(
+        {'E', name, kind, depth, static_cast<uint64_t>(time.count())});
+}
+
+void Tracer::writeJson(const std::string &file_name) {
+    std::ofstream out_file(file_name);
+    if (!out_file)
+        ERROR("Can't open file " + file_name);
+
+    out_file << "{\"traceEvents\": [\n";
+    for (size_t i = 0; i < events.size(); ++i) {
+        const Event &event = events.at(i);
+        out_file << "{\"name\": \"" << event.name << "\", \"ph\": \""
+                 << event.phase << "\", \"ts\": " << event.time
+                 << ", \"pid\": 1, \"tid\": 1";
+        if (event.phase == 'E')
+            out_file << ", \"args\": {\"kind\": \""
+                     << getNodeKindName(event.kind)
+                     << "\", \"depth\": " << event.depth << "}";
+        out_file << "}" << (i + 1 < events.size() ? ",\n" : "\n");
+    }
+    out_file << "],\n\"displayTimeUnit\": \"ms\"}\n";
+
+    if (!out_file)
+        ERROR("Can't write to file " + file_name);
+}
@@ -0,0 +1,100 @@
+/*
+Copyright (c) 2020, Intel Corporation
+Copyright (c) 2020, University of Utah
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+     http://www.apache.org/licenses/LICENSE-2.0
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//////////////////////////////////////////////////////////////////////////////
+#pragma once
+
+#include "enums.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace yarpgen {
+
+// Records the calls of the generator as begin/end events in Chrome
+// trace-event format, so a slow seed can be inspected in a trace viewer
+// (chrome://tracing or Perfetto). Each event has the kind of the IR node and
+// its depth, i.e., the number of enclosing events with the same name.
+// We trace only the generation, which runs on a single thread.
+class Tracer {
+  public:
+    static Tracer &getInstance() {
+        static Tracer instance;
+        return instance;
+    }
+    Tracer(const Tracer &) = delete;
+    Tracer &operator=(const Tracer &) = delete;
+
+    void enable() {
+        enabled = true;
+        start = std::chrono::steady_clock::now();
+    }
+    bool isEnabled() { return enabled; }
+
+    void begin(const char *name);
+    void end(const char *name, IRNodeKind kind);
+
+    void writeJson(const std::string &file_name);
+
+  private:
+    Tracer() : enabled(false) {}
+
+    struct Event {
+        // 'B' or 'E'
+        char phase;
+        const char *name;
+        IRNodeKind kind;
+        size_t depth;
+        // Microseconds since the tracer was enabled
+        uint64_t time;
+    };
+
+    bool enabled;
+    std::chrono::steady_clock::time_point start;
+    std::vector<Event> events;
+    // Names of the events that are still open
+    std::vector<const char *> open_events;
+};
+
+// Adds the begin event at its construction and the end event at its
+// destruction. The kind of the node can be set later (e.g., when
+// ArithmeticExpr::create picks it).
+class ScopedTraceEvent {
+  public:
+    ScopedTraceEvent(const char *_name,
+                     IRNodeKind _kind = IRNodeKind::MAX_STMT_KIND)
+        : name(_name), kind(_kind),
+          enabled(Tracer::getInstance().isEnabled()) {
+        if (enabled)
+            Tracer::getInstance().begin(name);
+    }
+    ~ScopedTraceEvent() {
+        if (enabled)
+            Tracer::getInstance().end(name, kind);
+    }
+    ScopedTraceEvent(const ScopedTraceEvent &) = delete;
+    ScopedTraceEvent &operator=(const ScopedTraceEvent &) = delete;
+
+    void setKind(IRNodeKind _kind) { kind = _kind; }
+
+  private:
+    const char *name;
+    IRNodeKind kind;
+    bool enabled;
+};
+
+} // namespace yarpgen
@@ -24,6 +24,7 @@ limitations under the License.
 #include "enums.h"
 #include "expr.h"
 #include "ir_value.h"
+#include "statistics.h"
 #include "type.h"
 #include "utils.h"
 
@@ -44,6 +45,7 @@ std::shared_ptr<IntegralType> IntegralType::init(IntTypeID _type_id,
                                                  bool _is_static,
                                                  CVQualifier _cv_qual,
                                                  bool _is_uniform) {
+    ScopedTimer timer(GenPhase::TYPE_INIT);
     // Folding set lookup
     IntTypeKey key(_type_id, _is_static, _cv_qual, _is_uniform);
     auto find_result = int_type_set.find(key);
@@ -200,7 +202,7 @@ DBG_DUMP_MACROS(TypeULLong)
 
 bool ArrayType::isSame(const std::shared_ptr<ArrayType> &lhs,
                        const std::shared_ptr<ArrayType> &rhs) {
-    return lhs->getUID() == rhs->getUID();
+    return lhs == rhs;
 }
 
 void ArrayType::dbgDump() {
@@ -222,17 +224,20 @@ void ArrayType::dbgDump() {
               << std::endl;
 }
 
-std::shared_ptr<ArrayType> ArrayType::init(std::shared_ptr<Type> _base_type,
-                                           std::vector<size_t> _dims) {
-    return init(std::move(_base_type), std::move(_dims),
+std::shared_ptr<ArrayType>
+ArrayType::init(std::shared_ptr<Type> _base_type,
+                const std::vector<size_t> &_dims) {
+    return init(std::move(_base_type), _dims,
                 /* is static */ false, CVQualifier::NONE);
 }
 
 std::shared_ptr<ArrayType>
-ArrayType::init(std::shared_ptr<Type> _base_type, std::vector<size_t> _dims,
-                bool _is_static, CVQualifier _cv_qual, bool _is_uniform) {
-    ArrayTypeKey key(_base_type, _dims, ArrayKind::MAX_ARRAY_KIND, _is_static,
-                     _cv_qual, _is_uniform);
+ArrayType::init(std::shared_ptr<Type> _base_type,
+                const std::vector<size_t> &_dims, bool _is_static,
+                CVQualifier _cv_qual, bool _is_uniform) {
+    ScopedTimer timer(GenPhase::TYPE_INIT);
+    ArrayTypeKey key(_base_type.get(), _dims, ArrayKind::MAX_ARRAY_KIND,
+                     _is_static, _cv_qual, _is_uniform);
     auto find_res = array_type_set.find(key);
     if (find_res != array_type_set.end())
         return find_res->second;
@@ -240,7 +245,10 @@ ArrayType::init(std::shared_ptr<Type> _base_type, std::vector<size_t> _dims,
     auto ret = std::make_shared<ArrayType>(_base_type, _dims, _is_static,
                                            _cv_qual, uid_counter++);
     ret->setIsUniform(_is_uniform);
-    array_type_set[key] = ret;
+    // The stored key should refer to the dimensions of the interned type,
+    // because the caller's vector can go away.
+    key.dims = &ret->dimensions;
+    array_type_set.emplace(key, ret);
     return ret;
 }
 
@@ -30,6 +30,7 @@ limitations under the License.
 #include "hash.h"
 #include "ir_value.h"
 #include "options.h"
+#include "statistics.h"
 
 namespace yarpgen {
 
@@ -143,7 +144,10 @@ class IntegralType : public ArithmeticType {
         int_type_set;
 };
 
-template <typename T> class IntegralTypeHelper : public IntegralType {
+template <typename T>
+class IntegralTypeHelper
+    : public IntegralType,
+      private MemTracked<IntegralTypeHelper<T>, MemKind::INTEGRAL_TYPE> {
   public:
     using value_type = T;
     IntegralTypeHelper(IntTypeID type_id, bool _is_static, CVQualifier _cv_qual)
@@ -299,17 +303,19 @@ class TypeULLong : public IntegralTypeHelper<uint64_t> {
 
 // Base class for all of the array-like types (C-style, Vector, Array,
 // ValArray).
-class ArrayType : public Type {
+class ArrayType : public Type,
+                  private MemTracked<ArrayType, MemKind::ARRAY_TYPE> {
   public:
-    ArrayType(std::shared_ptr<Type> _base_type, std::vector<size_t> _dims,
-              bool _is_static, CVQualifier _cv_qual, size_t _uid)
+    ArrayType(std::shared_ptr<Type> _base_type,
+              const std::vector<size_t> &_dims, bool _is_static,
+              CVQualifier _cv_qual, size_t _uid)
         : Type(_is_static, _cv_qual), base_type(std::move(_base_type)),
-          dimensions(std::move(_dims)), kind(ArrayKind::MAX_ARRAY_KIND),
-          uid(_uid) {}
+          dimensions(_dims), kind(ArrayKind::MAX_ARRAY_KIND), uid(_uid) {}
 
     bool isArrayType() final { return true; }
     std::shared_ptr<Type> getBaseType() { return base_type; }
-    std::vector<size_t> &getDimensions() { return dimensions; }
+    // Dimensions are a part of the folding set key, so they can't be changed
+    const std::vector<size_t> &getDimensions() { return dimensions; }
     size_t getUID() { return uid; }
 
     static bool isSame(const std::shared_ptr<ArrayType> &lhs,
@@ -318,11 +324,13 @@ class ArrayType : public Type {
     std::string getName(std::shared_ptr<EmitCtx> ctx) override;
     void dbgDump() override;
 
+    // Array types are interned, so equal types are always represented by
+    // the same object and can be compared by the pointer.
     static std::shared_ptr<ArrayType>
-    init(std::shared_ptr<Type> _base_type, std::vector<size_t> _dims,
+    init(std::shared_ptr<Type> _base_type, const std::vector<size_t> &_dims,
          bool _is_static, CVQualifier _cv_qual, bool _is_uniform = true);
-    static std::shared_ptr<ArrayType> init(std::shared_ptr<Type> _base_type,
-                                           std::vector<size_t> _dims);
+    static std::shared_ptr<ArrayType>
+    init(std::shared_ptr<Type> _base_type, const std::vector<size_t> &_dims);
     static std::shared_ptr<ArrayType> create(std::shared_ptr<PopulateCtx> ctx);
 
     std::shared_ptr<Type> makeVarying() override;
@@ -332,8 +340,8 @@ class ArrayType : public Type {
     static std::unordered_map<ArrayTypeKey, std::shared_ptr<ArrayType>,
                               ArrayTypeKeyHasher>
         array_type_set;
-    // The easiest way to compare array types is to assign a unique identifier
-    // to each of them and then compare it.
+    // Unique identifier of the interned type. It is used only for debug
+    // purposes, because we can compare the pointers directly.
     static size_t uid_counter;
 
     std::shared_ptr<Type> base_type;
@@ -25,6 +25,16 @@ limitations under the License.
 
 using namespace yarpgen;
 
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            std::cerr << "ERROR at " << __FILE__ << ":" << __LINE__            \
+                      << ", function " << __func__ << "():\n    " << (msg)     \
+                      << std::endl;                                            \
+            abort();                                                           \
+        }                                                                      \
+    } while (false)
+
 void type_test() {
     // Check for int type initialization
     for (auto i = static_cast<int>(IntTypeID::BOOL);
@@ -85,6 +95,31 @@ void type_test() {
                 ptr_to_type->dbgDump();
                 std::cout << "-------------------" << std::endl;
             }
+
+    // Check that array types are interned
+    auto int_type = IntegralType::init(IntTypeID::INT);
+    std::vector<size_t> dims = {10, 20, 30};
+    auto arr_type = ArrayType::init(int_type, dims);
+    std::vector<size_t> same_dims = dims;
+    CHECK(ArrayType::init(int_type, same_dims) == arr_type,
+          "Equal array types should be the same object");
+    CHECK(ArrayType::isSame(arr_type, ArrayType::init(int_type, dims)),
+          "Equal array types should be the same");
+    dims.back() = 31;
+    CHECK(arr_type->getDimensions().back() == 30,
+          "Interned type shouldn't depend on the caller's dimensions");
+    CHECK(ArrayType::init(int_type, dims) != arr_type,
+          "Array types with different dimensions should differ");
+    CHECK(ArrayType::init(IntegralType::init(IntTypeID::UINT), same_dims) !=
+              arr_type,
+          "Array types with different base types should differ");
+    CHECK(ArrayType::init(int_type, same_dims, /* is static */ true,
+                          CVQualifier::NONE) != arr_type,
+          "Static array type should differ from non-static");
+    CHECK(arr_type->makeVarying() ==
+              ArrayType::init(int_type->makeVarying(), same_dims, false,
+                              CVQualifier::NONE, false),
+          "Varying array types should be interned too");
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -49,8 +49,8 @@ class IRValue;
 template <typename T> class Probability {
   public:
     Probability(T _id, uint64_t _prob) : id(_id), prob(_prob) {}
-    T getId() { return id; }
-    uint64_t getProb() { return prob; }
+    T getId() const { return id; }
+    uint64_t getProb() const { return prob; }
 
     void increaseProb(uint64_t add_prob) { prob += add_prob; }
     void zeroProb() { prob = 0; }
@@ -105,9 +105,11 @@ class RandValGen {
     IRValue getRandValue(IntTypeID type_id);
 
     // Randomly chooses one of IDs, basing on std::vector<Probability<id>>.
-    template <typename T> T getRandId(std::vector<Probability<T>> vec) {
+    template <typename T>
+    T getRandId(const std::vector<Probability<T>> &vec) {
         std::vector<double> discrete_dis_init;
-        for (auto i : vec)
+        discrete_dis_init.reserve(vec.size());
+        for (const auto &i : vec)
             discrete_dis_init.push_back(i.getProb());
 
         std::discrete_distribution<size_t> discrete_dis(
@@ -150,6 +152,11 @@ class RandValGen {
     }
 
     uint64_t getSeed() { return seed; }
+    // Restarts the sequence of random values (the seed has to be non-zero)
+    void setSeed(uint64_t _seed) {
+        seed = _seed;
+        rand_gen = std::mt19937_64(seed);
+    }
 
   private:
     uint64_t seed;